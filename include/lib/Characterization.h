@@ -0,0 +1,156 @@
+#ifndef CHARACTERIZATION
+#define CHARACTERIZATION
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/FixedVector.h"
+  #include <stdint.h>
+
+  /// @brief 特性測定の試験の種類を選択できる列挙型
+  /// @param quasistatic 電圧を少しずつ上げる（加速度がほぼ０なので kS と kV が分かる）
+  /// @param dynamic 一定の電圧を急に掛ける（加速するので kA が分かる）
+  enum CharacterizationMode { quasistatic, dynamic };
+
+  /// @brief 特性測定の試験の動きを選択できる列挙型
+  /// @param linearAxis 前進（負の電圧で後退）
+  /// @param angularAxis その場での回転（正の電圧で反時計回り）
+  enum CharacterizationAxis { linearAxis, angularAxis };
+
+  /// @brief 特性測定の一つの試験
+  /// @param mode 試験の種類
+  /// @param axis 試験の動き
+  /// @param voltage quasistatic なら電圧の上げ方（ボルト毎秒）、dynamic なら掛ける電圧（ボルト）。負で逆方向
+  /// @param duration 試験の長さ（秒・ロボットが壁に当たらない長さにすること）
+  struct CharacterizationTest {
+    CharacterizationMode mode;
+    CharacterizationAxis axis;
+    float voltage;
+    float duration;
+  };
+
+  /// @brief 特性測定の一回分の記録
+  /// @param test 試験の番号
+  /// @param time 試験開始からの時間（秒）
+  /// @param voltage 各車輪に掛けた電圧（ボルト）
+  /// @param velocity ロボット視点の前進速度（インチ毎秒）
+  /// @param acceleration 前進の加速度（インチ毎秒毎秒・前回との差分）
+  /// @param omega 角速度（度毎秒・反時計回りが正）
+  /// @param alpha 角加速度（度毎秒毎秒・前回との差分）
+  /// @param wheel 回転による車輪の速度（インチ毎秒・轍間距離を求める為）
+  struct CharacterizationSample {
+    uint8_t test;
+    float time;
+    float voltage;
+    float velocity;
+    float acceleration;
+    float omega;
+    float alpha;
+    float wheel;
+  };
+
+  /// @brief 車台に電圧を直接掛けて特性を測定し、SDカードに CSV で保存するクラス。
+  /// 保存した CSV は tools/sysid/fit.cpp で kS、kV、kA、轍間距離、PIDゲインに変換できる（README 参照）
+  /// @tparam N 記録の数（5ミリ秒ごとなら4000で20秒分）
+  template <int N = 4000>
+  class Characterization {
+    public:
+      FixedVector<CharacterizationSample, N> samples; //　全ての試験の記録
+      CharacterizationTest tests[16]; //　実行した試験
+      int testCount = 0;              //　実行した試験の数
+      int period = 5;                 //　記録の間隔（ミリ秒）
+      float maxVoltage = 12;          //　最大電圧（ボルト）
+      float restTime = 1.5;           //　試験後にロボットが止まるまで待つ時間（秒）
+    public:
+      /// @brief 試験を一つ実行し記録する（終わるまで戻らない）
+      /// @param drive 車台（HolonomicDrive か DifferentialDrive）
+      /// @param test 実行する試験
+      /// @return 記録が全て収まったか（収まらなかった場合は途中で試験を止める）
+      template <class Drive>
+      bool run(Drive &drive, CharacterizationTest test) {
+          if (testCount >= 16) return false;
+          tests[testCount] = test;
+          drive.localize();
+          uint32_t start = vex::timer::system();
+          float lastTime = 0, lastVelocity = 0, lastOmega = 0;
+          bool first = true;
+          while (true) {
+            float t = (vex::timer::system() - start) / 1000.0f;
+            if (t >= test.duration || samples.full()) break;
+            float volts = test.mode == quasistatic ? test.voltage * t : test.voltage;
+            volts = fitToRange(volts, -maxVoltage, maxVoltage);
+            // 回転の出力は時計回りが正なので、反時計回りを正とする電圧の符号を反転
+            if (test.axis == linearAxis) drive.driveVoltage(volts, 0);
+            else drive.driveVoltage(0, -volts);
+            wait(period, msec);
+            drive.localize();
+            t = (vex::timer::system() - start) / 1000.0f;
+            Vector local = drive.velocity;
+            local.rotate( -drive.pose.w ); //　ロボット視点の速度に直す
+            float omega = drive.history.recent(0).omega;
+            float dt = t - lastTime;
+            CharacterizationSample sample;
+            sample.test = testCount;
+            sample.time = t;
+            sample.voltage = volts;
+            sample.velocity = local.y;
+            sample.acceleration = !first && dt > SMALL ? (local.y - lastVelocity) / dt : 0;
+            sample.omega = omega;
+            sample.alpha = !first && dt > SMALL ? (omega - lastOmega) / dt : 0;
+            sample.wheel = drive.rotationSpeed;
+            if (!samples.push_back(sample)) break; // 記録が満杯
+            lastTime = t;
+            lastVelocity = local.y;
+            lastOmega = omega;
+            first = false;
+          }
+          drive.stop();
+          wait(restTime * 1000, msec); // 次の試験に備えてロボットが止まるのを待つ
+          testCount++;
+          return !samples.full();
+      }
+      /// @brief 標準の試験を全て実行する（前進と後退、反時計回りと時計回りの quasistatic と dynamic）
+      /// @param drive 車台
+      /// @param ramp quasistatic の電圧の上げ方（ボルト毎秒）
+      /// @param step dynamic の電圧（ボルト）
+      /// @param duration 各試験の長さ（秒）
+      template <class Drive>
+      void runAll(Drive &drive, float ramp = 1, float step = 7, float duration = 3) {
+          CharacterizationTest suite[8] = {
+            {quasistatic, linearAxis, ramp, duration},
+            {quasistatic, linearAxis, -ramp, duration},
+            {dynamic, linearAxis, step, duration / 2},
+            {dynamic, linearAxis, -step, duration / 2},
+            {quasistatic, angularAxis, ramp, duration},
+            {quasistatic, angularAxis, -ramp, duration},
+            {dynamic, angularAxis, step, duration / 2},
+            {dynamic, angularAxis, -step, duration / 2}
+          };
+          for (int i = 0; i < 8; i++) if (!run(drive, suite[i])) break;
+      }
+      /// @brief 記録を消す
+      void clear() {
+          samples.clear();
+          testCount = 0;
+      }
+      /// @brief 記録を CSV としてSDカードに保存
+      /// @param filename ファイル名
+      /// @return 保存できたか（SDカードが入ってない場合は false）
+      bool save(const char *filename) {
+          if (!Brain.SDcard.isInserted()) return false;
+          FILE *file = fopen(filename, "w");
+          if (file == NULL) return false;
+          fprintf(file, "test,mode,axis,time,voltage,velocity,acceleration,omega,alpha,wheel\n");
+          for (int i = 0; i < samples.size(); i++) {
+            const CharacterizationSample &s = samples[i];
+            const CharacterizationTest &test = tests[s.test];
+            fprintf(file, "%d,%d,%d,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+              s.test, (int) test.mode, (int) test.axis, s.time, s.voltage,
+              s.velocity, s.acceleration, s.omega, s.alpha, s.wheel);
+          }
+          fclose(file);
+          return true;
+      }
+  };
+
+#endif
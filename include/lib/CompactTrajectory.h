@@ -0,0 +1,185 @@
+#ifndef COMPACT_TRAJECTORY
+#define COMPACT_TRAJECTORY
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/Pose.h"
+  #include "lib/Trajectory.h"
+  #include "lib/FixedVector.h"
+  #include <stdint.h>
+
+  /* 量子化の定数 */
+
+  const float COMPACT_DIST_SCALE = 256;              //　距離の分解能（1インチを256等分）
+  const float COMPACT_SPEED_SCALE = 32767;           //　速度の分解能（-1から1を int16 に）
+  const float COMPACT_HEADING_SCALE = 65536.0 / 360; //　角度の分解能（0から360度を uint16 に）
+
+  /* 量子化による最大誤差（丸めなので分解能の半分） */
+
+  const float COMPACT_DIST_ERROR = 0.5 / COMPACT_DIST_SCALE;       //　約0.002インチ（差分は丸めた累積値から取るので誤差は蓄積しない）
+  const float COMPACT_SPEED_ERROR = 0.5 / COMPACT_SPEED_SCALE;     //　約0.000015
+  const float COMPACT_HEADING_ERROR = 0.5 / COMPACT_HEADING_SCALE; //　約0.0027度
+
+  /// @brief 圧縮軌道と元の軌道の大きさと、実測した復元誤差の報告
+  /// @param samples 経由地の数
+  /// @param payloadBytes 経由地を保存した列が実際に使うバイト数
+  /// @param sourceBytes 同じ経由地を std::vector<Waypoint> に置いた場合のバイト数（要素と vector 本体）
+  /// @param reservedBytes 列の容量分の固定長配列のバイト数（経由地の数によらない）
+  /// @param overheadBytes 列以外の固定のバイト数（目印、姿勢、探索位置、報告など）
+  /// @param distError 距離の最大復元誤差（インチ）
+  /// @param speedError 速度の最大復元誤差
+  /// @param headingError 角度の最大復元誤差（度）
+  struct CompactReport {
+    int samples;
+    int payloadBytes;
+    int sourceBytes;
+    int reservedBytes;
+    int overheadBytes;
+    float distError;
+    float speedError;
+    float headingError;
+  };
+
+  /// @brief 量子化した経由地を配列の構造体（SoA）で保持する圧縮軌道クラス。
+  /// 距離は差分符号化した uint16、速度と角度は16ビット整数で保存する（Waypoint は20バイト）。
+  /// 列の構成は軌道の種類でコンパイル時に決まり、非ホロノミック系は x 方向の速度の列を持たないので一つの経由地は最大6バイト、ホロノミック系は最大8バイトとなる。
+  /// 各列は容量 N の固定長配列なので、圧縮中も実行中も動的確保を行わない。
+  /// 復元は（get）関数の探索と一体化しており、探索で通過する経由地の距離だけを足し合わせ、返す経由地のみを復元する。
+  /// @tparam N 経由地の容量（元の軌道の容量以上）
+  /// @tparam H ホロノミック系の軌道か
+  template <int N = TRAJECTORY_CAPACITY, bool H = false>
+  class BasicCompactTrajectory {
+    public:
+      static const bool holonomic = H; //　ホロノミック系の軌道か
+    private:
+      FixedVector<uint16_t, N> step;       //　経由地間の距離（量子化した累積距離の差分）
+      FixedVector<int16_t, H ? N : 1> vx;  //　x 方向の速度（非ホロノミック系は常に０なので容量１で使わない）
+      FixedVector<int16_t, N> vy;          //　y 方向の速度
+      FixedVector<uint16_t, N> w;          //　角度（角度を持たない軌道の場合は使わない）
+      bool angular = false;       //　角度を保存しているか
+      int cursor = 0;             //　前回探索した経由地の番号
+      uint32_t cursorDist = 0;    //　探索位置までの量子化した累積距離
+      CompactReport summary {0, 0, 0, 0, 0, 0, 0, 0}; //　圧縮時に作成した報告
+    public:
+      Pose initialPose {0,0,0}; //　初期姿勢
+      Pose finalPose {0,0,0};   //　最終姿勢
+      PathType type;            //　補間方法
+      bool orientation;         //　ホロノミック姿勢が示されているか
+      float length = 0;         //　補間式の長さ
+      MarkerList<> markers;     //　経路上の目印（元の軌道から引き継ぐ）
+    private:
+      /// @brief 軌道の経由地を量子化して保存
+      /// @param waypoints 元の軌道の経由地
+      template <class Waypoints>
+      void encode(const Waypoints &waypoints) {
+          int n = waypoints.size();
+          angular = H ? orientation : type == spline;
+          uint32_t previous = 0; //　前回の量子化した累積距離
+          float maxDist = 0, maxSpeed = 0, maxHeading = 0;
+          for (int i = 0; i < n; i++) {
+            const Waypoint &waypoint = waypoints[i];
+            // 累積距離を丸めてから差分を取ることで誤差が蓄積しないよう
+            uint32_t q = (uint32_t) lroundf(waypoint.dist * COMPACT_DIST_SCALE);
+            step.push_back(q - previous);
+            previous = q;
+            vy.push_back(lroundf(fitToRange(waypoint.heading.y, -1, 1) * COMPACT_SPEED_SCALE));
+            if (H) vx.push_back(lroundf(fitToRange(waypoint.heading.x, -1, 1) * COMPACT_SPEED_SCALE));
+            if (angular) w.push_back((uint16_t) lroundf(bound(waypoint.heading.w) * COMPACT_HEADING_SCALE));
+            // 実際の復元誤差を記録
+            Waypoint decoded = decode(i, q);
+            maxDist = fmax(maxDist, fabs(decoded.dist - waypoint.dist));
+            maxSpeed = fmax(maxSpeed, fabs(decoded.heading.y - waypoint.heading.y));
+            if (H) maxSpeed = fmax(maxSpeed, fabs(decoded.heading.x - waypoint.heading.x));
+            if (angular) maxHeading = fmax(maxHeading, fabs(wrap(decoded.heading.w, bound(waypoint.heading.w))));
+          }
+          int payload = step.size() * sizeof(uint16_t) + vx.size() * sizeof(int16_t) + vy.size() * sizeof(int16_t) + w.size() * sizeof(uint16_t);
+          int reserved = sizeof(step) + sizeof(vx) + sizeof(vy) + sizeof(w);
+          int source = n * sizeof(Waypoint) + sizeof(std::vector<Waypoint>);
+          summary = CompactReport {n, payload, source, reserved, (int) sizeof(*this) - reserved, maxDist, maxSpeed, maxHeading};
+      }
+      /// @brief 一つの経由地を復元
+      /// @param i 経由地の番号
+      /// @param q 量子化した累積距離
+      /// @return 復元された経由地
+      Waypoint decode(int i, uint32_t q) const {
+          Waypoint waypoint;
+          waypoint.type = type;
+          waypoint.dist = q / COMPACT_DIST_SCALE;
+          waypoint.heading.x = H ? vx[i] / COMPACT_SPEED_SCALE : 0;
+          waypoint.heading.y = vy[i] / COMPACT_SPEED_SCALE;
+          // 角度を持たないホロノミック軌道は元と同じく（ー１）を返す
+          waypoint.heading.w = angular ? w[i] / COMPACT_HEADING_SCALE : (H ? -1 : 0);
+          return waypoint;
+      }
+    public:
+      /// @brief 非ホロノミック系の軌道を圧縮
+      /// @param source 元の軌道
+      template <int M>
+      BasicCompactTrajectory(const BasicDifferentialTrajectory<M> &source) {
+          static_assert(!H, "use CompactDifferentialTrajectory for a differential trajectory");
+          static_assert(M <= N, "compact capacity must hold the source trajectory");
+          initialPose = source.initialPose;
+          finalPose = source.finalPose;
+          type = source.type;
+          orientation = false;
+          length = source.length;
+          markers = source.markers;
+          encode(source.waypoints);
+      }
+      /// @brief ホロノミック系の軌道を圧縮
+      /// @param source 元の軌道
+      template <int M>
+      BasicCompactTrajectory(const BasicHolonomicTrajectory<M> &source) {
+          static_assert(H, "use CompactHolonomicTrajectory for a holonomic trajectory");
+          static_assert(M <= N, "compact capacity must hold the source trajectory");
+          initialPose = source.initialPose;
+          finalPose = source.finalPose;
+          type = source.type;
+          orientation = source.orientation;
+          length = source.length;
+          markers = source.markers;
+          encode(source.waypoints);
+      }
+      /// @brief ある距離の入力に対し実行すべき経由地が返される（元の軌道の get と同じ）。
+      /// 前回の探索位置から差分を足しながら進むため、経路実行中は毎回数回の加算で済む
+      /// @param distanceTraveled ロボットが進んだ距離（単位はインチ）
+      /// @return 経由地
+      Waypoint get(float distanceTraveled) {
+          int n = step.size();
+          uint32_t target = (uint32_t) ceilf(fmax(distanceTraveled, 0) * COMPACT_DIST_SCALE);
+          // 探索位置より前に戻った場合は始めから探す
+          if (cursor > 0 && cursorDist - step[cursor] >= target) { cursor = 0; cursorDist = step[0]; }
+          if (cursor == 0) cursorDist = step[0];
+          while (cursorDist < target && cursor < n - 1) cursorDist += step[++cursor]; // 差分を足しながら次の経由地を特定
+          return decode(cursor, cursorDist); // 見つけた経由地だけを復元して返す
+      }
+      /// @brief 経由地の数
+      int size() const {
+          return step.size();
+      }
+      /// @brief 経由地 i - 1 から経由地 i までの距離（インチ・i が０の場合は始点から）
+      float segment(int i) const {
+          return step[i] / COMPACT_DIST_SCALE;
+      }
+      /// @brief 経由地 i の速度の出力の大きさ
+      float speed(int i) const {
+          float x = H ? vx[i] / COMPACT_SPEED_SCALE : 0;
+          return hypot(x, vy[i] / COMPACT_SPEED_SCALE);
+      }
+      /// @brief 経由地 i の進行方向（角度）。ホロノミック系は速度ベクトルの向き、非ホロノミック系はロボットの角度に90度を足す
+      float travelAngle(int i) const {
+          if (H) return Vector {(float) vx[i], (float) vy[i]}.getAngle();
+          float angle = angular ? w[i] / COMPACT_HEADING_SCALE : initialPose.w; // 直線補間は初期角度のまま
+          return bound(angle + 90 + (vy[i] < 0 ? 180 : 0));
+      }
+      /// @brief 圧縮の報告を返す
+      CompactReport report() const {
+          return summary;
+      }
+  };
+
+  typedef BasicCompactTrajectory<TRAJECTORY_CAPACITY, false> CompactDifferentialTrajectory; //　既定の容量（経由地100個）の非ホロノミック系の圧縮軌道
+  typedef BasicCompactTrajectory<TRAJECTORY_CAPACITY, true> CompactHolonomicTrajectory;     //　既定の容量（経由地100個）のホロノミック系の圧縮軌道
+
+#endif
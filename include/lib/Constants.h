@@ -0,0 +1,18 @@
+#ifndef CONSTANTS
+#define CONSTANTS
+
+  /* 数学定数 */
+
+  const float PI = 3.14159265359; //　piの値
+  const float E = 2.71828182846;  //  Eの値
+  const float SMALL = 0.00001;    //  小さい値
+
+  /* 変換 */
+
+  const float RadToDeg = 180 / PI;  //　掛けて弧度法を度数法に・割って度数法を弧度法
+
+  /* フィールド */
+
+  const float FIELD_SIZE = 144; //　フィールドの一辺の長さ（インチ・原点はフィールドの中心）
+
+#endif
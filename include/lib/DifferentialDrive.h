@@ -5,7 +5,15 @@
   #include "lib/Vector.h"
   #include "lib/Pose.h"
   #include "lib/Trajectory.h"
+  #include "lib/TimedTrajectory.h"
+  #include "lib/LQR.h"
+  #include "lib/Recording.h"
+  #include "lib/PoseHistory.h"
+  #include "lib/PathProgress.h"
+  #include "lib/TrackingStats.h"
   #include "lib/PID.h"
+  #include "lib/Saturation.h"
+  #include "lib/PowerManager.h"
 
   /// @brief 一般的非ホロノミック系ロボットの車台クラス
   class DifferentialDrive {
@@ -26,16 +34,33 @@
       float lastTime = 0; // 前ループ記録した時間
       float distanceTraveled = 0; // 走った距離
       PID omegaPID {0.008, 0, 0, 0.008, -1, 1}; // PID制御クラスの定義
+      PID alongPID {0.05, 0, 0, 0, -1, 1}; // 時間軌道の進行方向の位置偏差のPID制御
+      float startTime = -1; // 時間軌道の開始時間（ー１は未開始）
+      float command = 0;          // 最後に出した横断出力の大きさ
+      PowerManager *power = NULL; // 電力管理（登録されていなければ NULL）
+      int powerIndex = -1;        // 電力管理に登録した最初のモータの番号
     public:
       Pose pose {0, 0, 0};    // ロボットの姿勢オブジェクトを宣言
       Vector velocity {0, 0}; // ロボットの速度オブジェクトを宣言
+      SaturationPriority saturation = proportional; // 車輪が飽和した時の優先順位
+      bool saturated = false; // 前回の出力で車輪が飽和したか
+      float maxSpeed = 60;    // 前進出力１の時のロボットの速度（インチ毎秒）
+      float turnRate = 120;   // arcadeDrive の回転出力１の時のロボットの角速度（度毎秒）
+      float lag = 0;          // 時間軌道の計画に対する遅れ（秒・負なら先行）
+      PoseHistory<> history;    // 姿勢と出力の履歴
+      float latency = 0;        // 補う遅れ（ミリ秒・センサとモータの遅れの合計）
+      PathProgress<> pathProgress; // 軌道に射影した捗り（距離に基づく経路の実行中）
+      TrackingStats tracking;      // 前回（実行中なら今回）の経路の追従誤差と所要時間
+      float rotationSpeed = 0;  // 回転による車輪の速度（インチ毎秒・左と右のエンコーダーの差の半分）
     private:
       /// @brief 右と左車輪の出力を独立することでロボットを実際に操れる関数
       /// @param right 右車輪の出力 (-1から1)
       /// @param left 左車輪の出力 (-1から1)
       void drive(float left, float right) {
-        right *= MAX_VELOCITY; // 適当の速度を一般出力から導く
-        left *= MAX_VELOCITY;  //　適当の速度を一般出力から導く
+        // 電力管理がある場合、温度と電流の予算に従い左右を同じ比率で下げる
+        float limit = power != NULL ? power -> scale(powerIndex, 4) : 1;
+        right *= MAX_VELOCITY * limit; // 適当の速度を一般出力から導く
+        left *= MAX_VELOCITY * limit;  //　適当の速度を一般出力から導く
         FR.spin(forward, right, rpm); //　右前の出力を命令する
         FL.spin(forward, left , rpm); //　左前の出力を命令する
         RR.spin(forward, right, rpm); //　右後ろの出力を命令する
@@ -64,6 +89,16 @@
         reset(); // 経路関係の変数の初期化
         while(inertial.isCalibrating()) {wait(100, msec);} // センサの初期化処理を待つ
       }
+      /// @brief 車台のモータを電力管理に登録し、以後の速度命令を電力管理の比率で下げる
+      /// @param manager 電力管理
+      /// @param priority 車台のモータの優先度
+      void attach(PowerManager &manager, int priority = 1) {
+        power = &manager;
+        powerIndex = manager.add(FR, priority);
+        manager.add(FL, priority);
+        manager.add(RR, priority);
+        manager.add(RL, priority);
+      }
       /// @brief 経路実行前に変数の初期化
       void reset() {
         distanceTraveled = 0; // 走った距離
@@ -75,6 +110,16 @@
         this -> pose = pose; 
         setGyro(pose.w);
       }     
+      /// @brief 速度制御を使わず、左右の車輪に電圧を直接掛ける（特性測定用）
+      /// @param y 前進の電圧（ボルト）
+      /// @param w 回転の電圧（ボルト・時計回りが正）
+      void driveVoltage(float y, float w) {
+        command = fmin(fabs(y) / 12, 1); // 出力を履歴の為に保存
+        FR.spin(forward, y - w, volt);
+        FL.spin(forward, y + w, volt);
+        RR.spin(forward, y - w, volt);
+        RL.spin(forward, y + w, volt);
+      }
       /// @brief 全てのモータを停止
       void stop() {
         FR.stop(); 
@@ -86,17 +131,18 @@
       /// @param y 望むロボットのy軸出力（−１から１）
       /// @param w 望むロボットの回転出力（−１から１　時計回り）
       void arcadeDrive(float y, float w) {
+        command = fmin(fabs(y), 1); // 出力を履歴の為に保存
         w *= W_SCALER; // 定数スカラーを回転出力に掛ける
-        float right = y - w; // 右車輪の出力を導く
-        float left = y + w;  // 左車輪の出力を導く
-        // 右か左が１を超えている場合両値を比例的に減らす
-        float max = fmax( fmax( fabs(right), 1 ), left ); 
-        right = right/max; 
-        left = left/max; 
-        drive(left, right); // 左右独立出力関数に入力
+        float t[2] = { y, y }; // 左右車輪の前進による出力
+        float r[2] = { w, -w }; // 左右車輪の回転による出力
+        float out[2];
+        // 右か左の絶対値が１を超えている場合、優先順位に従い１以下に制限
+        saturated = desaturate(t, r, out, 2, saturation);
+        drive(out[0], out[1]); // 左右独立出力関数に入力
       }
       /// @brief 自己位置推定手法を更新
       void localize() {
+        float lastHeading = pose.w; // 前回の角度を保存
         pose.w = getGyro(); // イナーシャルセンサによるロボットの角度を更新
         float time = (vex::timer::system() - lastTime) / 1000; // 前回と今回の時差を秒に直す
         lastTime = vex::timer::system(); // 前回時間を初期化
@@ -105,6 +151,7 @@
         float right = encoderRight.velocity(vex::velocityUnits::dps) * DpsToRps;
         velocity.y = (right + left) / 2; //　右と左の平均をとり、進んだ距離を近似
         velocity.x = 0;                  //　x軸の動きは非ホロノミック系にはありえない
+        rotationSpeed = (left - right) / 2; // 回転速度は左と右の差を２で割ったもの
         //　ロボット視点の速度を一般視点に直すためにロボットの角度の分、速度ベクトルを回転します
         velocity.rotate( pose.w );
         Vector dist {velocity.x * time, velocity.y * time}; //　移動ベクトルは速度掛ける時間
@@ -112,24 +159,172 @@
         // 今回の移動ベクトルを合計位置推定ベクトルに追加
         pose.x += dist.x;
         pose.y += dist.y;
+        // 姿勢と出力を履歴に記録
+        float omega = time > 0 ? -wrap(pose.w, lastHeading) / time : 0;
+        history.push(PoseRecord {vex::timer::system(), pose, velocity, omega, command});
+      }
+      /// @brief 遅れの分だけ先の姿勢を予測（遅れが０なら現在の姿勢）
+      /// @return 出力が実際に効く時点のロボットの姿勢
+      Pose predicted() {
+        return latency > 0 && history.size() > 0 ? history.predict(latency, vex::timer::system()) : pose;
+      }
+      /// @brief 遅れて届いた位置の測定値（カメラなど）で自己位置を修正
+      /// @param measured 測定された位置（インチ）
+      /// @param time 測定した時刻（vex::timer::system のミリ秒）
+      /// @param gain 修正の割合（１で測定値を完全に信頼）
+      void correct( Vector measured, uint32_t time, float gain = 1 ) {
+        pose = history.correct(pose, measured, time, gain);
+      }
+      /// @brief 出力と速度の履歴から遅れを測定し、補う遅れとして設定する（加減速の直後に呼ぶ）
+      /// @return 測定された遅れ（ミリ秒）
+      float calibrateLatency() {
+        latency = history.measureLatency(maxSpeed);
+        return latency;
       }
       /// @brief 経路を実行
-      /// @param trajectory 走る経路
+      /// @param trajectory 走る経路（DifferentialTrajectory か CompactDifferentialTrajectory）
       /// @return 実行の捗り (0から1)
-      float follow(DifferentialTrajectory trajectory) {
+      template <class T>
+      float follow(T &trajectory) {
         localize(); // 自己位置推定手法を更新
-        float progress = fitToRange( distanceTraveled / trajectory.length, 0, 1 ); // 実行捗りを求める
-        if ( progress < 1 ) { // 実行が終了わってない限り
-          Waypoint waypoint = trajectory.get(distanceTraveled); // 走った距離を用い経路から次の経由地を特定
+        Pose current = predicted(); // 出力が効く時点の姿勢
+        bool starting = !pathProgress.active; // 初回の呼び出しか
+        float distance = pathProgress.update(trajectory, current); // 出力が効く時点の姿勢を軌道に射影した距離
+        if (starting) { // 計画された所要時間で記録を始め、目印を未通過に戻す
+          tracking.begin(pathProgress.total / maxSpeed, current.w);
+          trajectory.markers.reset();
+        }
+        float progress = fitToRange( distance / trajectory.length, 0, 1 ); // 実行捗りを求める
+        trajectory.markers.update( distance, progress, pathProgress.schedule / maxSpeed ); // 通過した目印を呼ぶ
+        if ( !pathProgress.finished && progress < 1 ) { // 終点を越えてない限り
+          Waypoint waypoint = ReferenceWaypoint(trajectory, pathProgress.index, distance); // 射影した区間の終点の経由地
           //　スプライン補間の場合、PID制御を用いて目的角度を到達するために適切な出力を導く。
           //　概念的には、現在角度と目的角度の最短差を導き、その差が０に近づけるよに出力量を決める
-          float w = trajectory.type == spline ? omegaPID.get( wrap(pose.w, waypoint.heading.w) , 0) : 0;
+          float w = trajectory.type == spline ? omegaPID.get( wrap(current.w, waypoint.heading.w) , 0) : 0;
           arcadeDrive( waypoint.heading.y, w ); // 左右独立出力関数に入力
+          // 計画上その点に着くべき時間との差に速度を掛け、進行方向の誤差とする（正は先行）
+          float speed = Vector {waypoint.heading.x, waypoint.heading.y}.getMagnitude() * maxSpeed;
+          float along = (pathProgress.schedule / maxSpeed - tracking.elapsed()) * speed;
+          float target = trajectory.type == spline ? waypoint.heading.w : tracking.initialHeading;
+          tracking.add( pathProgress.crossTrack, along, wrap(target, current.w), progress, saturated );
           return progress; //　実行捗りを毎回返す
         }      
+        trajectory.markers.finish(); // 残りの目印を呼ぶ
+        pathProgress.reset(); // 次の経路に備える
+        tracking.end();
         stop();   // モータを全て停止
         return 1; // 経路が無事実行されたことを再び示す
       }
+      /// @brief 時間で媒介変数表示された経路を実行。参照状態の速度と角速度を前向き制御に使い、
+      /// 進行方向の位置偏差と角度の偏差だけをPID制御で補う
+      /// @param trajectory 走る経路
+      /// @return 実行の捗り（経過時間 / 計画された所要時間）
+      template <int N>
+      float follow(TimedTrajectory<N> &trajectory) {
+        localize(); // 自己位置推定手法を更新
+        Pose current = predicted(); // 出力が効く時点の姿勢
+        if (startTime < 0) { // 初回の呼び出しで開始時間を記録
+          startTime = vex::timer::system();
+          tracking.begin(trajectory.duration, current.w);
+          trajectory.markers.reset();
+          trajectory.anchor(current); // 直線補間の軌道は現在の姿勢を始点とする
+        }
+        float t = (vex::timer::system() - startTime) / 1000; // 経過時間（秒）
+        if ( t < trajectory.duration ) { // 計画された時間が終わってない限り
+          TrajectoryState reference = trajectory.sample(t); // 現在時刻の参照状態
+          trajectory.markers.update( reference.dist, reference.dist / fmax(trajectory.length, SMALL), t ); // 通過した目印を呼ぶ
+          // ロボットの前方向（角度０は上向き）への位置偏差
+          Vector forward {reference.heading + 90};
+          float along = (reference.x - current.x) * forward.x + (reference.y - current.y) * forward.y;
+          lag = fabs(reference.v) > SMALL ? along / reference.v : 0; // 計画に対する遅れ
+          float y = reference.v / maxSpeed + alongPID.get(0, along); // 参照速度に位置偏差の補正を足す
+          // 反時計回りの角速度は負の回転出力となる
+          float w = trajectory.orientation ? -reference.omega / turnRate + omegaPID.get( wrap(current.w, reference.heading), 0) : 0;
+          arcadeDrive( y, w ); // 左右独立出力関数に入力
+          Vector error = TrackError(current.x - reference.x, current.y - reference.y, reference.heading + 90 + (reference.v < 0 ? 180 : 0));
+          float target = trajectory.orientation ? reference.heading : tracking.initialHeading;
+          tracking.add( error.y, error.x, wrap(target, current.w), t / trajectory.duration, saturated );
+          return t / trajectory.duration; //　実行捗りを毎回返す
+        }
+        trajectory.markers.finish(); // 残りの目印を呼ぶ
+        startTime = -1; // 次の経路に備える
+        tracking.end();
+        alongPID.reset();
+        stop();   // モータを全て停止
+        return 1; // 経路が無事実行されたことを示す
+      }
+      /// @brief 時間で媒介変数表示された経路を LQR で実行。参照状態の速度と角速度を前向き制御に使い、
+      /// 参照の前方向と左方向の位置と角度の偏差に、事前に求めた参照状態ごとの利得を掛けて補う
+      /// @param trajectory 走る経路
+      /// @param gains trajectory から求めた非ホロノミック系の利得（gains.solve(trajectory)）
+      /// @return 実行の捗り（経過時間 / 計画された所要時間）
+      template <int N>
+      float follow(TimedTrajectory<N> &trajectory, const LQRGains<N, false> &gains) {
+        localize(); // 自己位置推定手法を更新
+        Pose current = predicted(); // 出力が効く時点の姿勢
+        if (startTime < 0) { // 初回の呼び出しで開始時間を記録
+          startTime = vex::timer::system();
+          tracking.begin(trajectory.duration, current.w);
+          trajectory.markers.reset();
+          trajectory.anchor(current); // 直線補間の軌道は現在の姿勢を始点とする
+        }
+        float t = (vex::timer::system() - startTime) / 1000; // 経過時間（秒）
+        if ( t < trajectory.duration ) { // 計画された時間が終わってない限り
+          TrajectoryState reference = trajectory.sample(t); // 現在時刻の参照状態
+          trajectory.markers.update( reference.dist, reference.dist / fmax(trajectory.length, SMALL), t ); // 通過した目印を呼ぶ
+          // 参照の前方向（x）と左方向（y）の位置偏差と角度の偏差（弧度）
+          Vector error = TrackError(current.x - reference.x, current.y - reference.y, reference.heading + 90);
+          float heading = wrap(reference.heading, current.w);
+          Pose u = LQRGains<N, false>::correct(gains.at(t, trajectory.interval), error.x, error.y, heading / RadToDeg);
+          lag = fabs(reference.v) > SMALL ? -error.x / reference.v : 0; // 計画に対する遅れ
+          float y = (reference.v + u.x) / maxSpeed; // 参照速度に補正を足す
+          // 反時計回りの角速度は負の回転出力となる
+          float w = -(reference.omega + u.w * RadToDeg) / turnRate;
+          arcadeDrive( y, w ); // 左右独立出力関数に入力
+          tracking.add( reference.v < 0 ? -error.y : error.y, reference.v < 0 ? -error.x : error.x, heading, t / trajectory.duration, saturated );
+          return t / trajectory.duration; //　実行捗りを毎回返す
+        }
+        trajectory.markers.finish(); // 残りの目印を呼ぶ
+        startTime = -1; // 次の経路に備える
+        tracking.end();
+        stop();   // モータを全て停止
+        return 1; // 経路が無事実行されたことを示す
+      }
+      /// @brief 手動操作の記録を再生。記録された姿勢を時間の参照状態とし、その差から求めた速度と角速度を前向き制御に使い、
+      /// 位置と角度の偏差をPID制御で補う（入力をそのまま流すのではないので、ずれても記録の経路に戻る）
+      /// @param replay 開いた記録（replay.open(filename)）
+      /// @return 実行の捗り（経過時間 / 記録の所要時間）
+      template <int B>
+      float follow(PoseReplay<B> &replay) {
+        localize(); // 自己位置推定手法を更新
+        Pose current = predicted(); // 出力が効く時点の姿勢
+        if (startTime < 0) { // 初回の呼び出しで開始時間を記録
+          startTime = vex::timer::system();
+          tracking.begin(replay.duration, current.w);
+        }
+        float t = (vex::timer::system() - startTime) / 1000; // 経過時間（秒）
+        TrajectoryState reference;
+        if ( replay.sample(t, reference) ) { // 記録が終わってない限り
+          // ロボットの前方向（角度０は上向き）への位置偏差
+          Vector forward {reference.heading + 90};
+          float along = (reference.x - current.x) * forward.x + (reference.y - current.y) * forward.y;
+          lag = fabs(reference.v) > SMALL ? along / reference.v : 0; // 記録に対する遅れ
+          float y = reference.v / maxSpeed + alongPID.get(0, along); // 記録の速度に位置偏差の補正を足す
+          // 反時計回りの角速度は負の回転出力となる
+          float w = -reference.omega / turnRate + omegaPID.get( wrap(current.w, reference.heading), 0);
+          arcadeDrive( y, w ); // 左右独立出力関数に入力
+          Vector error = TrackError(current.x - reference.x, current.y - reference.y, reference.heading + 90 + (reference.v < 0 ? 180 : 0));
+          float progress = replay.duration > SMALL ? fmin(t / replay.duration, 1) : 0;
+          tracking.add( error.y, error.x, wrap(reference.heading, current.w), progress, saturated );
+          return progress < 1 ? progress : 0.999; //　実行捗りを毎回返す（１は終わった時だけ）
+        }
+        replay.close();
+        startTime = -1; // 次の経路に備える
+        tracking.end();
+        alongPID.reset();
+        stop();   // モータを全て停止
+        return 1; // 記録が無事再生されたことを示す
+      }
   };
 
 #endif
\ No newline at end of file
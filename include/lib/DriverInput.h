@@ -0,0 +1,144 @@
+#ifndef DRIVER_INPUT
+#define DRIVER_INPUT
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/PID.h"
+  #include <stdint.h>
+
+  /// @brief ジョイスティックの応答曲線を選択できる列挙型
+  /// @param linearResponse そのまま
+  /// @param quadraticResponse 二次関数（中央付近が細かい）
+  /// @param cubicResponse 三次関数（中央付近がさらに細かい）
+  /// @param expoResponse 直線と三次関数の混合（EXPO で割合を指定）
+  enum ResponseCurve { linearResponse, quadraticResponse, cubicResponse, expoResponse };
+
+  const int AXIS_MAX = 127; //　ジョイスティックの最大値
+
+  /// @brief コンパイル時に 0 から N-1 の整数の並びを作るテンプレート（C++11 には std::index_sequence がない為）
+  template <int... I> struct IndexSequence {};
+  template <int N, int... I> struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+  template <int... I> struct MakeIndexSequence<0, I...> { typedef IndexSequence<I...> type; };
+
+  /// @brief デッドバンドを除き、残りの範囲を 0 から 1 に伸ばす（デッドバンドの外側で出力が跳ねない）
+  /// @param raw ジョイスティックの値の絶対値（0から127）
+  constexpr float Deadbanded(int raw) {
+    return raw <= BAND ? 0 : (float) (raw - BAND) / (AXIS_MAX - BAND);
+  }
+
+  /// @brief 0 から 1 の入力に応答曲線を施す
+  /// @param curve 応答曲線
+  /// @param x 入力（0から1）
+  /// @param expo expoResponse の三次関数の割合（パーセント）
+  constexpr float ResponseShape(ResponseCurve curve, float x, int expo) {
+    return curve == quadraticResponse ? x * x
+         : curve == cubicResponse ? x * x * x
+         : curve == expoResponse ? (1 - expo / 100.0f) * x + expo / 100.0f * x * x * x
+         : x;
+  }
+
+  /// @brief ジョイスティックの全ての値（0から127）の応答をコンパイル時に求めた参照表
+  template <ResponseCurve C, int EXPO, class S> struct ResponseTable;
+  template <ResponseCurve C, int EXPO, int... I>
+  struct ResponseTable<C, EXPO, IndexSequence<I...> > {
+    static constexpr float values[sizeof...(I)] = { ResponseShape(C, Deadbanded(I), EXPO)... };
+  };
+  template <ResponseCurve C, int EXPO, int... I>
+  constexpr float ResponseTable<C, EXPO, IndexSequence<I...> >::values[sizeof...(I)];
+
+  /// @brief ジョイスティック一軸の入力処理。デッドバンドと応答曲線は参照表を引くだけで、
+  /// 出力の変化は傾き制限（スルーレート）で滑らかにする
+  /// @tparam C 応答曲線
+  /// @tparam EXPO expoResponse の三次関数の割合（パーセント）
+  template <ResponseCurve C = quadraticResponse, int EXPO = 50>
+  class InputAxis {
+    private:
+      typedef ResponseTable<C, EXPO, typename MakeIndexSequence<AXIS_MAX + 1>::type> Table;
+      float output = 0;      //　前回の出力
+      uint32_t lastTime = 0; //　前回の時間（ミリ秒）
+    public:
+      float rise; //　０から離れる方向の最大変化（毎秒・０で制限なし）
+      float fall; //　０に近づく方向の最大変化（毎秒・０で制限なし）
+    public:
+      /// @brief 入力処理を作成
+      /// @param rise ０から離れる方向の最大変化（毎秒・０で制限なし）
+      /// @param fall ０に近づく方向の最大変化（毎秒・０で制限なし）
+      InputAxis(float rise = 0, float fall = 0) {
+          this -> rise = rise;
+          this -> fall = fall;
+      }
+      /// @brief 応答曲線だけを施した値（傾き制限なし）
+      /// @param raw ジョイスティックの値（ー127から127）
+      /// @return ー１から１
+      static float shape(int raw) {
+          int magnitude = raw < 0 ? -raw : raw;
+          if (magnitude > AXIS_MAX) magnitude = AXIS_MAX;
+          return raw < 0 ? -Table::values[magnitude] : Table::values[magnitude];
+      }
+      /// @brief ジョイスティックの値を処理した出力
+      /// @param raw ジョイスティックの値（ー127から127）
+      /// @return ー１から１
+      float get(int raw) {
+          float target = shape(raw);
+          uint32_t now = vex::timer::system();
+          float dt = lastTime == 0 ? 0 : (now - lastTime) / 1000.0f;
+          lastTime = now;
+          // ０から離れるか（符号が変わる場合はまず０に向かう）
+          bool away = fabs(target) > fabs(output) && target * output >= 0;
+          float rate = away ? rise : fall;
+          if (rate > 0 && dt > 0) output += fitToRange(target - output, -rate * dt, rate * dt);
+          else output = target;
+          return output;
+      }
+      /// @brief 出力を０に戻す
+      void reset() {
+          output = 0;
+          lastTime = 0;
+      }
+  };
+
+  /// @brief 回転スティックが中央にある間、イナーシャルセンサで角度を保つクラス。
+  /// スティックを離してから delay の間は回転の勢いが収まるのを待ち、その時の角度を目標にする
+  class HeadingHold {
+    private:
+      PID pid;               //　角度を保つPID制御
+      float target = 0;      //　保つ角度
+      bool holding = false;  //　角度を保っているか
+      uint32_t released = 0; //　最後に回転スティックが動いていた時間（ミリ秒）
+    public:
+      bool enabled = true; //　角度を保つか
+      uint32_t delay = 200; //　スティックを離してから角度を記録するまでの時間（ミリ秒）
+    public:
+      /// @brief 角度保持を作成
+      /// @param pid 角度の偏差（度）から回転出力を求めるPID制御
+      HeadingHold(PID pid = PID {0.015, 0, 0, 0.008, -1, 1}) : pid(pid) {}
+      /// @brief 回転出力を求める
+      /// @param w 回転スティックの出力（ー１から１）
+      /// @param heading ロボットの角度（度数）
+      /// @return 回転出力（スティックが動いている間はそのまま）
+      float get(float w, float heading) {
+          uint32_t now = vex::timer::system();
+          if (!enabled || fabs(w) > SMALL) { // 運転士が回している
+            holding = false;
+            released = now;
+            return w;
+          }
+          if (!holding) {
+            if (now - released < delay) return 0; // 回転の勢いが収まるのを待つ
+            target = heading;
+            holding = true;
+            pid.reset();
+          }
+          // 反時計回りの偏差は負の回転出力となる
+          return pid.get( wrap(heading, target), 0 );
+      }
+      /// @brief 保つ角度を変える（自動操作の後など）
+      /// @param heading 角度（度数）
+      void hold(float heading) {
+          target = heading;
+          holding = true;
+          pid.reset();
+      }
+  };
+
+#endif
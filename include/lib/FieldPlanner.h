@@ -0,0 +1,329 @@
+#ifndef FIELD_PLANNER
+#define FIELD_PLANNER
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/Trajectory.h"
+  #include <stdint.h>
+  #include <string.h>
+
+  /// @brief フィールドをビット詰めで表す占有格子（1ビットで1マス）
+  /// @tparam W x 方向のマス数
+  /// @tparam H y 方向のマス数
+  template <int W, int H>
+  class OccupancyGrid {
+    private:
+      uint32_t bits[(W * H + 31) / 32]; //　占有情報（1なら障害物）
+    public:
+      const float cellWidth = FIELD_SIZE / W;  //　マスの x 方向の幅（インチ）
+      const float cellHeight = FIELD_SIZE / H; //　マスの y 方向の幅（インチ）
+    public:
+      /// @brief 空の格子を作成
+      OccupancyGrid() {
+          clear();
+      }
+      /// @brief 全てのマスを空きにする
+      void clear() {
+          memset(bits, 0, sizeof(bits));
+      }
+      /// @brief マスの占有状態を変更
+      /// @param cx マスの x 番号
+      /// @param cy マスの y 番号
+      /// @param occupied 障害物か否か
+      void set(int cx, int cy, bool occupied = true) {
+          if (!contains(cx, cy)) return; //　範囲外は無視
+          int i = cy * W + cx;
+          if (occupied) bits[i >> 5] |= (1u << (i & 31));
+          else bits[i >> 5] &= ~(1u << (i & 31));
+      }
+      /// @brief マスが障害物か確認（範囲外は障害物として扱う）
+      /// @param cx マスの x 番号
+      /// @param cy マスの y 番号
+      /// @return 障害物か否か
+      bool occupied(int cx, int cy) const {
+          if (!contains(cx, cy)) return true;
+          int i = cy * W + cx;
+          return (bits[i >> 5] >> (i & 31)) & 1u;
+      }
+      /// @brief マスが格子の範囲内か確認
+      bool contains(int cx, int cy) const {
+          return cx >= 0 && cx < W && cy >= 0 && cy < H;
+      }
+      /// @brief フィールド座標（インチ）からマスの x 番号を求める
+      int cellX(float x) const {
+          return (int) floorf((x + FIELD_SIZE / 2) / cellWidth);
+      }
+      /// @brief フィールド座標（インチ）からマスの y 番号を求める
+      int cellY(float y) const {
+          return (int) floorf((y + FIELD_SIZE / 2) / cellHeight);
+      }
+      /// @brief マスの中心のフィールド座標を返す
+      Vector center(int cx, int cy) const {
+          return Vector {(cx + 0.5f) * cellWidth - FIELD_SIZE / 2, (cy + 0.5f) * cellHeight - FIELD_SIZE / 2};
+      }
+      /// @brief 長方形の障害物を登録
+      /// @param a 長方形の角（インチ）
+      /// @param b 対角の角（インチ）
+      void fillRect(Vector a, Vector b) {
+          int x0 = cellX(fmin(a.x, b.x)), x1 = cellX(fmax(a.x, b.x));
+          int y0 = cellY(fmin(a.y, b.y)), y1 = cellY(fmax(a.y, b.y));
+          for (int cy = y0; cy <= y1; cy++)
+            for (int cx = x0; cx <= x1; cx++) set(cx, cy);
+      }
+      /// @brief 円形の障害物を登録
+      /// @param c 円の中心（インチ）
+      /// @param radius 半径（インチ）
+      void fillCircle(Vector c, float radius) {
+          for (int cy = cellY(c.y - radius); cy <= cellY(c.y + radius); cy++)
+            for (int cx = cellX(c.x - radius); cx <= cellX(c.x + radius); cx++) {
+              Vector p = center(cx, cy);
+              if (hypot(p.x - c.x, p.y - c.y) <= radius) set(cx, cy);
+            }
+      }
+      /// @brief 障害物をロボットの半径分だけ膨張させる（経路はロボットの中心として扱える）
+      /// @param radius ロボットの外接円の半径（インチ）
+      void inflate(float radius) {
+          OccupancyGrid<W, H> source = *this; //　膨張前の状態を保存
+          int rx = (int) ceilf(radius / cellWidth);
+          int ry = (int) ceilf(radius / cellHeight);
+          for (int cy = 0; cy < H; cy++)
+            for (int cx = 0; cx < W; cx++) {
+              if (!source.occupied(cx, cy)) continue;
+              for (int dy = -ry; dy <= ry; dy++)
+                for (int dx = -rx; dx <= rx; dx++)
+                  if (hypot(dx * cellWidth, dy * cellHeight) <= radius) set(cx + dx, cy + dy);
+            }
+      }
+  };
+
+  /// @brief 占有格子上で A* または Theta* 探索を行い、既存の軌道クラスが実行できるエルミート区間に変換する経路計画クラス。
+  /// 探索に必要な全ての配列は固定長のメンバーで、計画中に動的確保は一切行わない。
+  /// 72×72マスの場合約70KBを使うため、グローバル変数として宣言すること（タスクのスタックに置かない）。
+  /// @tparam W x 方向のマス数
+  /// @tparam H y 方向のマス数
+  /// @tparam MAX_ROUTE 経路の頂点の最大数
+  template <int W, int H, int MAX_ROUTE = 32>
+  class FieldPlanner {
+    static_assert(W * H < 0xFFFF, "grid too large for 16-bit node indices");
+    private:
+      static const uint16_t NONE = 0xFFFF; //　未定義のノード
+      const OccupancyGrid<W, H> &grid; //　探索する占有格子
+      float g[W * H];          //　始点からの最短コスト（インチ）
+      float f[W * H];          //　コストと推定残りコストの和
+      uint16_t parent[W * H];  //　親ノード
+      uint16_t heap[W * H];    //　固定長の二分ヒープ
+      uint16_t heapPos[W * H]; //　ヒープ内の位置（NONE はヒープ外）
+      uint32_t closed[(W * H + 31) / 32]; //　探索済みノード
+      int heapSize = 0; //　ヒープの要素数
+      int goal = 0;     //　目的ノード
+    public:
+      Vector route[MAX_ROUTE]; //　計画された経路の頂点（フィールド座標）
+      int routeSize = 0;       //　経路の頂点数
+      bool anyAngle = true;    //　true なら Theta*（任意角度）、false なら A*（8方向）
+      int expanded = 0;        //　前回の計画で展開したノード数
+    private:
+      int index(int cx, int cy) const { return cy * W + cx; }
+      int nodeX(int i) const { return i % W; }
+      int nodeY(int i) const { return i / W; }
+      bool isClosed(int i) const { return (closed[i >> 5] >> (i & 31)) & 1u; }
+      void close(int i) { closed[i >> 5] |= (1u << (i & 31)); }
+      /// @brief 二つのノード間のユークリッド距離（インチ）
+      float cost(int a, int b) const {
+          return hypot((nodeX(a) - nodeX(b)) * grid.cellWidth, (nodeY(a) - nodeY(b)) * grid.cellHeight);
+      }
+      /// @brief ヒープ内の要素を入れ替え
+      void swap(int a, int b) {
+          uint16_t t = heap[a]; heap[a] = heap[b]; heap[b] = t;
+          heapPos[heap[a]] = a;
+          heapPos[heap[b]] = b;
+      }
+      /// @brief ヒープの要素を上に移動
+      void siftUp(int i) {
+          while (i > 0) {
+            int p = (i - 1) / 2;
+            if (f[heap[p]] <= f[heap[i]]) break;
+            swap(i, p);
+            i = p;
+          }
+      }
+      /// @brief ヒープの要素を下に移動
+      void siftDown(int i) {
+          while (true) {
+            int l = 2 * i + 1, r = l + 1, m = i;
+            if (l < heapSize && f[heap[l]] < f[heap[m]]) m = l;
+            if (r < heapSize && f[heap[r]] < f[heap[m]]) m = r;
+            if (m == i) break;
+            swap(i, m);
+            i = m;
+          }
+      }
+      /// @brief ノードをヒープに追加、または既にある場合は優先度を更新
+      void push(int node) {
+          if (heapPos[node] == NONE) {
+            heap[heapSize] = node;
+            heapPos[node] = heapSize;
+            heapSize++;
+          }
+          siftUp(heapPos[node]);
+      }
+      /// @brief 最小のノードをヒープから取り出す
+      int pop() {
+          int top = heap[0];
+          heapSize--;
+          swap(0, heapSize);
+          heapPos[top] = NONE;
+          siftDown(0);
+          return top;
+      }
+      /// @brief 二つのノードの間に障害物がないか確認（通過する全てのマスを調べる）
+      bool lineOfSight(int a, int b) const {
+          int x0 = nodeX(a), y0 = nodeY(a), x1 = nodeX(b), y1 = nodeY(b);
+          int dx = abs(x1 - x0), dy = abs(y1 - y0);
+          int sx = x1 > x0 ? 1 : -1, sy = y1 > y0 ? 1 : -1;
+          int error = dx - dy;
+          for (int n = dx + dy; n > 0; n--) {
+            int e2 = 2 * error;
+            if (e2 == 0) { //　マスの角を通る場合は両隣も確認
+              if (grid.occupied(x0 + sx, y0) || grid.occupied(x0, y0 + sy)) return false;
+              x0 += sx; y0 += sy; error += dx - dy; n--;
+            } else if (e2 > 0) { x0 += sx; error -= dy; }
+            else { y0 += sy; error += dx; }
+            if (grid.occupied(x0, y0)) return false;
+          }
+          return true;
+      }
+      /// @brief 任意の二点を結ぶ線分が障害物を通らないか（マスの幅の四分の一ごとに調べる）
+      /// @param a 端点（インチ）
+      /// @param b 端点（インチ）
+      bool visible(Vector a, Vector b) const {
+          float step = fmin(grid.cellWidth, grid.cellHeight) / 4;
+          int n = (int) ceilf(hypot(b.x - a.x, b.y - a.y) / step);
+          for (int i = 0; i <= n; i++) {
+            float u = n > 0 ? (float) i / n : 0;
+            if (grid.occupied(grid.cellX(a.x + (b.x - a.x) * u), grid.cellY(a.y + (b.y - a.y) * u))) return false;
+          }
+          return true;
+      }
+      /// @brief ノードの経由コストを更新（Theta* の場合は親の親からの直線も試す）
+      void relax(int current, int next) {
+          int from = current;
+          if (anyAngle && parent[current] != NONE && lineOfSight(parent[current], next)) from = parent[current];
+          float candidate = g[from] + cost(from, next);
+          if (candidate < g[next]) {
+            g[next] = candidate;
+            f[next] = candidate + cost(next, goal);
+            parent[next] = from;
+            push(next);
+          }
+      }
+    public:
+      /// @brief 経路計画器を作成
+      /// @param grid 探索する占有格子
+      FieldPlanner(const OccupancyGrid<W, H> &grid) : grid(grid) {}
+      /// @brief 始点から目的地までの経路を計画
+      /// @param start 始点（インチ）
+      /// @param target 目的地（インチ）
+      /// @return 経路が見つかったか否か
+      bool plan(Vector start, Vector target) {
+          routeSize = 0;
+          expanded = 0;
+          int sx = grid.cellX(start.x), sy = grid.cellY(start.y);
+          int tx = grid.cellX(target.x), ty = grid.cellY(target.y);
+          if (grid.occupied(sx, sy) || grid.occupied(tx, ty)) return false; //　始点か目的地が障害物の中
+          // 作業用配列の初期化
+          for (int i = 0; i < W * H; i++) { g[i] = 1e30f; parent[i] = NONE; heapPos[i] = NONE; }
+          memset(closed, 0, sizeof(closed));
+          heapSize = 0;
+          goal = index(tx, ty);
+          int origin = index(sx, sy);
+          g[origin] = 0;
+          f[origin] = cost(origin, goal);
+          push(origin);
+          while (heapSize > 0) {
+            int current = pop();
+            if (current == goal) break;
+            close(current);
+            expanded++;
+            int cx = nodeX(current), cy = nodeY(current);
+            // 8方向の隣接マスを調べる
+            for (int dy = -1; dy <= 1; dy++)
+              for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dy == 0) continue;
+                int nx = cx + dx, ny = cy + dy;
+                if (grid.occupied(nx, ny)) continue;
+                // 斜め移動で障害物の角を削らないよう
+                if (dx != 0 && dy != 0 && (grid.occupied(cx + dx, cy) || grid.occupied(cx, cy + dy))) continue;
+                int next = index(nx, ny);
+                if (isClosed(next)) continue;
+                relax(current, next);
+              }
+          }
+          if (g[goal] >= 1e30f) return false; //　到達不可能
+          // 探索後は不要なヒープ配列を再利用し、目的地から始点までの親の連鎖を並べる
+          int count = 0;
+          for (int n = goal; n != NONE; n = parent[n]) heap[count++] = n;
+          // 見通しの通る頂点を飛ばして経路を単純化（A* の階段状の経路も数個の頂点になる）
+          int anchor = count - 1;
+          route[routeSize++] = grid.center(nodeX(heap[anchor]), nodeY(heap[anchor]));
+          while (anchor > 0) {
+            int next = anchor - 1;
+            while (next > 0 && lineOfSight(heap[anchor], heap[next - 1])) next--;
+            if (routeSize == MAX_ROUTE) { routeSize = 0; return false; } //　頂点が多すぎる
+            route[routeSize++] = grid.center(nodeX(heap[next]), nodeY(heap[next]));
+            anchor = next;
+          }
+          // 始点と目的地が同じマスの場合は二点を直接結ぶ（空きのマスの中の線分は障害物を通らない）
+          if (routeSize == 1) {
+            route[0] = start;
+            route[routeSize++] = target;
+            return true;
+          }
+          // 端点はマスの中心でなく指定された座標を使う。指定された座標から見通しが通らない場合はマスの中心を経由する
+          if (visible(start, route[1])) route[0] = start;
+          else {
+            if (routeSize == MAX_ROUTE) { routeSize = 0; return false; }
+            for (int i = routeSize; i > 0; i--) route[i] = route[i - 1];
+            route[0] = start;
+            routeSize++;
+          }
+          if (visible(route[routeSize - 2], target)) route[routeSize - 1] = target;
+          else {
+            if (routeSize == MAX_ROUTE) { routeSize = 0; return false; }
+            route[routeSize++] = target;
+          }
+          return true;
+      }
+      /// @brief 経路の頂点におけるエルミート接線。方向は前後の頂点を結ぶ向き（Catmull-Rom）、
+      /// 大きさは隣接する区間の短い方の長さとし、膨らみ過ぎて障害物に入らないようにする
+      /// @param i 頂点番号
+      /// @return 接線ベクトル
+      Vector tangent(int i) const {
+          Vector prev = route[i > 0 ? i - 1 : i];
+          Vector next = route[i < routeSize - 1 ? i + 1 : i];
+          Vector direction {next.x - prev.x, next.y - prev.y};
+          float length = direction.getMagnitude();
+          if (length < SMALL) return Vector {0, 0};
+          float chord = 1e30f;
+          if (i > 0) chord = fmin(chord, hypot(route[i].x - route[i-1].x, route[i].y - route[i-1].y));
+          if (i < routeSize - 1) chord = fmin(chord, hypot(route[i+1].x - route[i].x, route[i+1].y - route[i].y));
+          direction.scale(chord / length);
+          return direction;
+      }
+      /// @brief 計画された経路のエルミート区間の数
+      int segments() const {
+          return routeSize > 1 ? routeSize - 1 : 0;
+      }
+      /// @brief 頂点 i から i+1 までのエルミート区間（Path として既存の軌道クラスに渡せる）
+      /// @param i 区間番号
+      Path segment(int i) const {
+          return Path {route[i], route[i+1], tangent(i), tangent(i+1)};
+      }
+      /// @brief 頂点 i から i+2 までの区分的エルミート区間（PathPlus として既存の軌道クラスに渡せる）
+      /// @param i 最初の区間番号
+      PathPlus segmentPair(int i) const {
+          return PathPlus {route[i], route[i+1], route[i+2], tangent(i), tangent(i+1), tangent(i+2)};
+      }
+  };
+
+#endif
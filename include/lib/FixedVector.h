@@ -0,0 +1,54 @@
+#ifndef FIXED_VECTOR
+#define FIXED_VECTOR
+
+  #include "lib/Include.h"
+
+  /// @brief 容量が固定された配列クラス（std::vector の代わりに使い、実行中に動的確保を行わない）。
+  /// 要素はオブジェクト内に直接置かれるため、メモリ使用量はコンパイル時に決まる。
+  /// @tparam T 要素の型
+  /// @tparam N 最大要素数
+  template <class T, int N>
+  class FixedVector {
+    private:
+      T items[N] {}; //　要素の配列（空の時に at が返す items[0] も初期化済み）
+      int count = 0; //　現在の要素数
+    public:
+      int dropped = 0; //　容量を超えて追加できなかった要素の数（０でなければ容量が足りない）
+    public:
+      /// @brief 要素を末尾に追加（容量を超えた場合は追加せず dropped を数える）
+      /// @param item 追加する要素
+      /// @return 追加できたか否か
+      bool push_back(const T &item) {
+          if (count >= N) {
+            dropped++;
+            return false;
+          }
+          items[count++] = item;
+          return true;
+      }
+      /// @brief 範囲を制限して要素を返す（範囲外の場合は最も近い要素、空の場合は初期値の items[0]）
+      /// @param i 要素の番号
+      T &at(int i) {
+          return items[count == 0 || i < 0 ? 0 : (i >= count ? count - 1 : i)];
+      }
+      const T &at(int i) const {
+          return items[count == 0 || i < 0 ? 0 : (i >= count ? count - 1 : i)];
+      }
+      T &operator[](int i) { return items[i]; }
+      const T &operator[](int i) const { return items[i]; }
+      T &front() { return items[0]; }
+      const T &front() const { return items[0]; }
+      T &back() { return items[count - 1]; }
+      const T &back() const { return items[count - 1]; }
+      T *begin() { return items; }
+      const T *begin() const { return items; }
+      T *end() { return items + count; }
+      const T *end() const { return items + count; }
+      int size() const { return count; }
+      bool empty() const { return count == 0; }
+      bool full() const { return count == N; }
+      void clear() { count = 0; dropped = 0; }
+      static int capacity() { return N; }
+  };
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef HEADING_PROFILE
+#define HEADING_PROFILE
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include <initializer_list>
+
+  /// @brief 目的のホロノミック姿勢を経路の特定の処理位置に登録（ホロノミック姿勢はホロノミック車台の角度を示します。
+  /// ホロノミック系のロボットは平面的横断と回転を同時に行う機能を持ち、進行方向と別の角度を保つことができる）。
+  /// @param dist 特定する処理位置 (0 から 1)
+  /// @param angle　ロボットの角度
+  struct HolonomicPose {
+    float dist;
+    float angle;
+  };
+
+  /// @brief ホロノミック姿勢の間の角度の補間方法を選択できる列挙型
+  /// @param linearHeading 直線補間（姿勢ごとに角速度が跳ねる）
+  /// @param cubicHeading 三次エルミート補間（角速度が連続、端点では角速度０）
+  /// @param minimumJerkHeading 最小躍度補間（各姿勢で角速度と角加速度が０）
+  enum HeadingInterpolation { linearHeading, cubicHeading, minimumJerkHeading };
+
+  /// @brief 回転の物理的な制限。０の項目は制限しない
+  /// @param maxSpeed 速度出力１の時のロボットの速度（インチ毎秒）
+  /// @param maxOmega 最大角速度（度毎秒）
+  /// @param maxAlpha 最大角加速度（度毎秒毎秒）
+  struct HeadingConstraints {
+    float maxSpeed;
+    float maxOmega;
+    float maxAlpha;
+  };
+
+  /// @brief ホロノミック姿勢の配列から各処理位置の角度を求めるクラス。
+  /// 処理位置は単調に増える前提で、区間の探索位置を保持しながら経由地と同時に一度だけ姿勢を走査する。
+  /// 区分的補間（PathPlus）で点B以降の姿勢を０から１で示した場合（README の例）、前の姿勢より小さい処理位置は１を足して扱う。
+  class HeadingProfile {
+    private:
+      const HolonomicPose *keys;          //　ホロノミック姿勢の配列（補間器より長く生きること）
+      int count;                          //　ホロノミック姿勢の数
+      HeadingInterpolation interpolation; //　補間方法
+      int k = 0;       //　現在の区間の始めの姿勢の番号
+      float e[4];      //　区間の前、始め、終わり、次の姿勢の処理位置
+      float a[4];      //　上記の姿勢の角度（巻き戻しなしの連続値）
+      bool edge[4];    //　上記の姿勢が配列の範囲外か
+    private:
+      /// @brief 姿勢 i の処理位置と角度を前の姿勢を基準に求める
+      /// @param slot 保存する位置
+      /// @param i 姿勢の番号
+      /// @param previous 前の姿勢の保存位置
+      void load(int slot, int i, int previous) {
+          int n = count;
+          edge[slot] = i < 0 || i >= n;
+          if (edge[slot]) { e[slot] = e[previous]; a[slot] = a[previous]; return; }
+          float dist = keys[i].dist;
+          // 前の姿勢より小さい処理位置は点B以降の区間を０から１で示したものとして扱う
+          e[slot] = dist < e[previous] ? dist + 1 : dist;
+          a[slot] = a[previous] + wrap(keys[i - 1].angle, keys[i].angle); //　最短角度差を足して連続値にする
+      }
+      /// @brief 三次補間の姿勢 slot における傾き（度毎処理位置）。前後の傾きの符号が違う場合は０で行き過ぎを防ぐ
+      float slope(int slot) const {
+          if (edge[slot - 1] || edge[slot + 1]) return 0; //　最初と最後の姿勢では回転を止める
+          float h0 = e[slot] - e[slot - 1], h1 = e[slot + 1] - e[slot];
+          if (h0 < SMALL || h1 < SMALL) return 0;
+          float d0 = (a[slot] - a[slot - 1]) / h0, d1 = (a[slot + 1] - a[slot]) / h1;
+          if (d0 * d1 <= 0) return 0;
+          float m = (a[slot + 1] - a[slot - 1]) / (h0 + h1);
+          return copysignf(fmin(fabs(m), 3 * fmin(fabs(d0), fabs(d1))), m);
+      }
+    public:
+      /// @brief ホロノミック姿勢の補間器を作成
+      /// @param keys ホロノミック姿勢の配列（処理位置の最初と最後の姿勢は必ず定義されている）
+      /// @param count ホロノミック姿勢の数
+      /// @param interpolation 補間方法
+      HeadingProfile(const HolonomicPose *keys, int count, HeadingInterpolation interpolation = linearHeading) : keys(keys), count(count) {
+          this -> interpolation = interpolation;
+          if (count == 0) return;
+          // 最初の区間の四つの姿勢を読み込む
+          edge[0] = true;
+          e[1] = keys[0].dist;
+          a[1] = keys[0].angle;
+          edge[1] = false;
+          e[0] = e[1]; a[0] = a[1];
+          load(2, 1, 1);
+          load(3, 2, 2);
+      }
+      /// @brief ホロノミック姿勢の初期化リストから補間器を作成（リストは補間器を使い終わるまで生きること）
+      /// @param keys ホロノミック姿勢の初期化リスト
+      /// @param interpolation 補間方法
+      HeadingProfile(std::initializer_list<HolonomicPose> keys, HeadingInterpolation interpolation = linearHeading)
+        : HeadingProfile(keys.begin(), keys.size(), interpolation) {}
+      /// @brief ホロノミック姿勢が示されているか
+      bool empty() const {
+          return count == 0;
+      }
+      /// @brief 最初の姿勢の角度
+      float first() const {
+          return count == 0 ? 0 : keys[0].angle;
+      }
+      /// @brief 最後の姿勢の角度
+      float last() const {
+          return count == 0 ? 0 : keys[count - 1].angle;
+      }
+      /// @brief 処理位置 x の角度を求める（x は前回以上であること）
+      /// @param x 処理位置（区分的補間の場合は０から２）
+      /// @return 角度（0から360度）、ホロノミック姿勢が示されてない場合（ー１）
+      float get(float x) {
+          if (count == 0) return -1; //　ホロノミック姿勢が示されてない場合（ー１）を返す
+          // 処理位置が現在の区間を超えたら次の区間へ（経由地ごとに高々数回）
+          while (x > e[2] && !edge[3]) {
+            for (int j = 0; j < 3; j++) { e[j] = e[j + 1]; a[j] = a[j + 1]; edge[j] = edge[j + 1]; }
+            k++;
+            load(3, k + 2, 2);
+          }
+          if (edge[2]) return bound(a[1]); //　姿勢が一つしかない場合
+          float h = e[2] - e[1];
+          float u = h < SMALL ? 1 : fitToRange((x - e[1]) / h, 0, 1); //　区間内の位置（0から1）
+          float angle;
+          if (interpolation == cubicHeading) {
+            // 三次エルミート基底関数
+            float u2 = u * u, u3 = u2 * u;
+            angle = (2*u3 - 3*u2 + 1) * a[1] + (u3 - 2*u2 + u) * h * slope(1)
+                  + (-2*u3 + 3*u2) * a[2] + (u3 - u2) * h * slope(2);
+          } else if (interpolation == minimumJerkHeading) {
+            float s = u * u * u * (10 - 15 * u + 6 * u * u); //　最小躍度の補間関数
+            angle = a[1] + (a[2] - a[1]) * s;
+          } else {
+            angle = a[1] + (a[2] - a[1]) * u; //　直線補間
+          }
+          return bound(angle);
+      }
+  };
+
+#endif
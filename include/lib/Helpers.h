@@ -1,7 +1,9 @@
 #ifndef HELPERS 
 #define HELPERS
 
-  #include "lib/Include.h"
+  #include <math.h>
+  #include <vector>
+  #include "lib/Constants.h"
 
   /// @brief 二つの角度の最短角度差を返す関数
   /// @param current 現在角度
@@ -25,7 +27,7 @@
   /// @brief 数字の配列の平均を取る
   /// @param nums 数字だけの　std::vector
   /// @return 配列の平均
-  float avg(std::vector<float> nums) {
+  float avg(const std::vector<float> &nums) {
     if (nums.empty()) return 0; // ０で割らないよう
     float total = 0;
     for (float n : nums) total += n; // 要素の和
@@ -5,8 +5,17 @@
   #include "lib/Vector.h"
   #include "lib/Pose.h"
   #include "lib/Trajectory.h"
+  #include "lib/TimedTrajectory.h"
+  #include "lib/LQR.h"
+  #include "lib/Recording.h"
+  #include "lib/PoseHistory.h"
+  #include "lib/PathProgress.h"
+  #include "lib/TrackingStats.h"
   #include "lib/PID.h"
   #include "lib/Helpers.h"
+  #include "lib/Saturation.h"
+  #include "lib/DriverInput.h"
+  #include "lib/PowerManager.h"
 
   #include "lib/Controller.h"
 
@@ -26,6 +35,17 @@
         Vector velocity = {0,0};  // ロボットの速度オブジェクトを宣言
         int progress = 0;         // 経路実行の捗り
         bool fieldCentric = true; // 運転士視点操作
+        SaturationPriority saturation = proportional; // 車輪が飽和した時の優先順位
+        bool saturated = false;   // 前回の出力で車輪が飽和したか
+        float maxSpeed = 60;      // 横断出力１の時のロボットの速度（インチ毎秒）
+        float turnRate = 300;     // 回転出力１の時のロボットの角速度（度毎秒）
+        float lag = 0;            // 時間軌道の計画に対する遅れ（秒・負なら先行）
+        PoseHistory<> history;    // 姿勢と出力の履歴
+        float latency = 0;        // 補う遅れ（ミリ秒・センサとモータの遅れの合計）
+        PathProgress<> pathProgress; // 軌道に射影した捗り（距離に基づく経路の実行中）
+        TrackingStats tracking;      // 前回（実行中なら今回）の経路の追従誤差と所要時間
+        float rotationSpeed = 0;  // 回転による車輪の速度（インチ毎秒・右と左のエンコーダーの差の半分）
+        HeadingHold headingHold;  // 回転スティックが中央の時に角度を保つ
     private:
         const float ODOMETRY_WHEEL_DIAMETER = 2.75; // 車輪の直径
         const float WHEEL_MAX_RPM = 180; // 最高速度の定数（rpm）
@@ -35,9 +55,15 @@
         Vector RL_component {135}; // 北西に向く単位ベクトルは左後ろモータの方向進行
         Vector RR_component {45};  // 北東に向く単位ベクトルは右後ろモータの方向進行
         PID omegaPID {0.015, 0, 0, 0.008, -1, 1}; // PID制御クラスの定義
+        PID xPID {0.05, 0, 0, 0, -1, 1}; // 時間軌道の x 方向の位置偏差のPID制御
+        PID yPID {0.05, 0, 0, 0, -1, 1}; // 時間軌道の y 方向の位置偏差のPID制御
     private:
         float lastTime = 0;         // 前ループ記録した時間
         float distanceTraveled = 0; // 走った距離
+        float startTime = -1;       // 時間軌道の開始時間（ー１は未開始）
+        float command = 0;          // 最後に出した横断出力の大きさ
+        PowerManager *power = NULL; // 電力管理（登録されていなければ NULL）
+        int powerIndex = -1;        // 電力管理に登録した最初のモータの番号
     private:
         /// @brief イナーシャルセンサの角度を変更
         /// @param angle 角度（度数）
@@ -62,6 +88,16 @@
             encoderRear.setReversed(false);  // 後ろエンコーダーの方向を設定
             while (inertial.isCalibrating()) wait(20, msec); // センサの初期化処理を待つ
         }
+        /// @brief 車台のモータを電力管理に登録し、以後の速度命令を電力管理の比率で下げる
+        /// @param manager 電力管理
+        /// @param priority 車台のモータの優先度
+        void attach( PowerManager &manager, int priority = 1 ) {
+            power = &manager;
+            powerIndex = manager.add(FR, priority);
+            manager.add(FL, priority);
+            manager.add(RL, priority);
+            manager.add(RR, priority);
+        }
         /// @brief 自己位置推定手法初期化
         /// @param pose ロボットの姿勢
         void setPose( Pose pose ) {
@@ -70,6 +106,7 @@
         }
         /// @brief 自己位置推定手法を更新
         void localize() {
+            float lastHeading = pose.w; // 前回の角度を保存
             pose.w = getGyro(); // イナーシャルセンサによるロボットの角度を更新
             float time = (vex::timer::system() - lastTime) / 1000; // 前回と今回の時差を秒に直す
             lastTime = vex::timer::system(); // 前回時間を初期化
@@ -78,6 +115,7 @@
             float right = encoderRight.velocity(vex::velocityUnits::dps) * DpsToRps;
             float rear  = encoderRear.velocity(vex::velocityUnits::dps) * DpsToRps;
             float rot = (left - right) / 2; // 回転速度は右と左の差を２で割ったもの
+            rotationSpeed = rot;
             velocity.x = rear - rot; //　x軸の速度は後ろの速度から回転速度を引いたもの
             velocity.y = ( (right - rot) + (left + rot) ) / 2; // y軸の速度は回転を補った右と左の平均
             // ロボット視点の速度を一般視点に直すためにロボットの角度の分、速度ベクトルを回転します
@@ -87,33 +125,74 @@
             // 今回の移動ベクトルを合計位置推定ベクトルに追加
             pose.x += dist.x; 
             pose.y += dist.y;
+            // 姿勢と出力を履歴に記録
+            float omega = time > 0 ? -wrap(pose.w, lastHeading) / time : 0;
+            history.push(PoseRecord {vex::timer::system(), pose, velocity, omega, command});
+        }
+        /// @brief 遅れの分だけ先の姿勢を予測（遅れが０なら現在の姿勢）
+        /// @return 出力が実際に効く時点のロボットの姿勢
+        Pose predicted() {
+            return latency > 0 && history.size() > 0 ? history.predict(latency, vex::timer::system()) : pose;
+        }
+        /// @brief 遅れて届いた位置の測定値（カメラなど）で自己位置を修正
+        /// @param measured 測定された位置（インチ）
+        /// @param time 測定した時刻（vex::timer::system のミリ秒）
+        /// @param gain 修正の割合（１で測定値を完全に信頼）
+        void correct( Vector measured, uint32_t time, float gain = 1 ) {
+            pose = history.correct(pose, measured, time, gain);
+        }
+        /// @brief 出力と速度の履歴から遅れを測定し、補う遅れとして設定する（加減速の直後に呼ぶ）
+        /// @return 測定された遅れ（ミリ秒）
+        float calibrateLatency() {
+            latency = history.measureLatency(maxSpeed);
+            return latency;
         }
         /// @brief コントローラ操作を行う関数
         /// @param translation 望む平面横断を表す単位ベクトル
         /// @param w 望む回転速度（ー１から１）
         void arcadeDrive( Vector translation, float w ) {
+            command = fmin(translation.getMagnitude(), 1); // 出力を履歴の為に保存
             // 運転士視点操作の場合得られた横断ベクトルをロボットの角度の分、逆回転させます
-            if (fieldCentric) translation.rotate( -pose.w );
-            float fr = ( translation.y * FR_component.y) + ( translation.x * FR_component.x) - w;
-            float fl = ( translation.y * FL_component.y) + ( translation.x * FL_component.x) + w;
-            float rl = ( translation.y * RL_component.y) + ( translation.x * RL_component.x) + w;
-            float rr = ( translation.y * RR_component.y) + ( translation.x * RR_component.x) - w;
-            float max = fmax( fmax( fabs(fr), fabs(fl) ), fmax( fabs(rl), fabs(rr) ) ); // 一番高い値を探す
-            if (max > 1) { // その値が１より高ければ全ての値を比例的に減らす（１以下に制限）
-                fr /= max; // 一番でかい値で割る（１以下になる）
-                fl /= max; // 一番でかい値で割る（１以下になる）
-                rl /= max; // 一番でかい値で割る（１以下になる）
-                rr /= max; // 一番でかい値で割る（１以下になる）
-            }
-            fr *= WHEEL_MAX_RPM;  // 適当な速度を導く
-            fl *= WHEEL_MAX_RPM;  // 適当な速度を導く
-            rl *= WHEEL_MAX_RPM;  // 適当な速度を導く
-            rr *= WHEEL_MAX_RPM;  // 適当な速度を導く
+            // 遅れを補う場合は出力が効く時点の予測角度を使う
+            if (fieldCentric) translation.rotate( -predicted().w );
+            // 平面的横断と回転による各車輪（右前、左前、左後ろ、右後ろ）の出力を別々に求める
+            float t[4] = {
+                ( translation.y * FR_component.y) + ( translation.x * FR_component.x),
+                ( translation.y * FL_component.y) + ( translation.x * FL_component.x),
+                ( translation.y * RL_component.y) + ( translation.x * RL_component.x),
+                ( translation.y * RR_component.y) + ( translation.x * RR_component.x)
+            };
+            float r[4] = { -w, w, w, -w };
+            float out[4];
+            // 一番高い値が１より高ければ優先順位に従い１以下に制限
+            saturated = desaturate(t, r, out, 4, saturation);
+            // 電力管理がある場合、温度と電流の予算に従い全ての車輪を同じ比率で下げる
+            float limit = power != NULL ? power -> scale(powerIndex, 4) : 1;
+            float fr = out[0] * WHEEL_MAX_RPM * limit;  // 適当な速度を導く
+            float fl = out[1] * WHEEL_MAX_RPM * limit;  // 適当な速度を導く
+            float rl = out[2] * WHEEL_MAX_RPM * limit;  // 適当な速度を導く
+            float rr = out[3] * WHEEL_MAX_RPM * limit;  // 適当な速度を導く
             FR.spin(forward, fr, vex::velocityUnits::rpm);  // モータに速度命令
             FL.spin(forward, fl, vex::velocityUnits::rpm);  // モータに速度命令
             RL.spin(forward, rl, vex::velocityUnits::rpm);  // モータに速度命令
             RR.spin(forward, rr, vex::velocityUnits::rpm);  // モータに速度命令
         }
+        /// @brief 手動操作用のコントローラ操作。回転スティックが中央の時はイナーシャルセンサで角度を保つ
+        /// @param translation 望む平面横断を表す単位ベクトル
+        /// @param w 回転スティックの出力（ー１から１）
+        void holdDrive( Vector translation, float w ) {
+            arcadeDrive( translation, headingHold.get(w, pose.w) );
+        }
+        /// @brief 速度制御を使わず、各車輪に電圧を直接掛ける（特性測定用）
+        /// @param y ロボット視点の前進の電圧（ボルト）
+        /// @param w 回転の電圧（ボルト・時計回りが正）
+        void driveVoltage( float y, float w ) {
+            command = fmin(fabs(y) / 12, 1); // 出力を履歴の為に保存
+            FR.spin(forward, y - w, vex::voltageUnits::volt);
+            FL.spin(forward, y + w, vex::voltageUnits::volt);
+            RL.spin(forward, y + w, vex::voltageUnits::volt);
+            RR.spin(forward, y - w, vex::voltageUnits::volt);
+        }
         /// @brief 全てのモータを停止
         void stop() {
             FR.stop();
@@ -122,22 +201,163 @@
             RR.stop();
         }
         /// @brief 経路を実行
-        /// @param trajectory 走る経路
+        /// @param trajectory 走る経路（HolonomicTrajectory か CompactHolonomicTrajectory）
         /// @return 実行の捗り (0から1)
-        float follow(HolonomicTrajectory trajectory) {
+        template <class T>
+        float follow(T &trajectory) {
             localize(); // 自己位置推定手法を更新
-            float progress = fitToRange( distanceTraveled / trajectory.length, 0, 1 ); // 実行捗りを求める
-            if ( progress < 1 ) { // 実行が終了わってない限り
-                Waypoint waypoint = trajectory.get(distanceTraveled); // 走った距離を用い経路から次の経由地を特定
+            Pose current = predicted(); // 出力が効く時点の姿勢
+            bool starting = !pathProgress.active; // 初回の呼び出しか
+            float distance = pathProgress.update(trajectory, current); // 出力が効く時点の姿勢を軌道に射影した距離
+            if (starting) { // 計画された所要時間で記録を始め、目印を未通過に戻す
+              tracking.begin(pathProgress.total / maxSpeed, current.w);
+              trajectory.markers.reset();
+            }
+            float progress = fitToRange( distance / trajectory.length, 0, 1 ); // 実行捗りを求める
+            trajectory.markers.update( distance, progress, pathProgress.schedule / maxSpeed ); // 通過した目印を呼ぶ
+            if ( !pathProgress.finished && progress < 1 ) { // 終点を越えてない限り
+                Waypoint waypoint = ReferenceWaypoint(trajectory, pathProgress.index, distance); // 射影した区間の終点の経由地
                 //　ホロノミック姿勢の場合、PID制御を用いて目的角度を到達するために適切な出力を導く。
                 //　概念的には、現在角度と目的角度の最短差を導き、その差が０に近づけるよに出力量を決める
-                float w = trajectory.orientation ? omegaPID.get( wrap(pose.w, waypoint.heading.w) , 0) : 0;
+                float w = trajectory.orientation ? omegaPID.get( wrap(current.w, waypoint.heading.w) , 0) : 0;
                 arcadeDrive( Vector {waypoint.heading.x, waypoint.heading.y}, w ); // コントローラ操作の関数に入力
+                // 計画上その点に着くべき時間との差に速度を掛け、進行方向の誤差とする（正は先行）
+                float speed = Vector {waypoint.heading.x, waypoint.heading.y}.getMagnitude() * maxSpeed;
+                float along = (pathProgress.schedule / maxSpeed - tracking.elapsed()) * speed;
+                float target = trajectory.orientation ? waypoint.heading.w : tracking.initialHeading;
+                tracking.add( pathProgress.crossTrack, along, wrap(target, current.w), progress, saturated );
                 return progress; //　実行捗りを毎回返す
             }      
+            trajectory.markers.finish(); // 残りの目印を呼ぶ
+            pathProgress.reset(); // 次の経路に備える
+            tracking.end();
             stop();   // モータを全て停止
             return 1; // 経路が無事実行されたことを再び示す
         }
+        /// @brief 時間で媒介変数表示された経路を実行。参照状態の速度と角速度を前向き制御に使い、
+        /// 位置と角度の偏差だけをPID制御で補う
+        /// @param trajectory 走る経路
+        /// @return 実行の捗り（経過時間 / 計画された所要時間）
+        template <int N>
+        float follow(TimedTrajectory<N> &trajectory) {
+            localize(); // 自己位置推定手法を更新
+            Pose current = predicted(); // 出力が効く時点の姿勢
+            if (startTime < 0) { // 初回の呼び出しで開始時間を記録
+              startTime = vex::timer::system();
+              tracking.begin(trajectory.duration, current.w);
+              trajectory.markers.reset();
+              trajectory.anchor(current); // 直線補間の軌道は現在の姿勢を始点とする
+            }
+            float t = (vex::timer::system() - startTime) / 1000; // 経過時間（秒）
+            if ( t < trajectory.duration ) { // 計画された時間が終わってない限り
+                TrajectoryState reference = trajectory.sample(t); // 現在時刻の参照状態
+                trajectory.markers.update( reference.dist, reference.dist / fmax(trajectory.length, SMALL), t ); // 通過した目印を呼ぶ
+                // 参照速度を出力に直したものに位置偏差の補正を足す
+                Vector translation {
+                    reference.vx / maxSpeed + xPID.get(current.x, reference.x),
+                    reference.vy / maxSpeed + yPID.get(current.y, reference.y)
+                };
+                // 反時計回りの角速度は負の回転出力となる
+                float w = trajectory.orientation ? -reference.omega / turnRate + omegaPID.get( wrap(current.w, reference.heading), 0) : 0;
+                // 進行方向の偏差を参照速度で割り、計画に対する遅れを求める
+                float speed = hypot(reference.vx, reference.vy);
+                float along = ( (reference.x - current.x) * reference.vx + (reference.y - current.y) * reference.vy ) / fmax(speed, SMALL);
+                lag = speed > SMALL ? along / speed : 0;
+                arcadeDrive( translation, w ); // コントローラ操作の関数に入力
+                Vector error = TrackError(current.x - reference.x, current.y - reference.y, Vector {reference.vx, reference.vy}.getAngle());
+                float target = trajectory.orientation ? reference.heading : tracking.initialHeading;
+                tracking.add( error.y, error.x, wrap(target, current.w), t / trajectory.duration, saturated );
+                return t / trajectory.duration; //　実行捗りを毎回返す
+            }
+            trajectory.markers.finish(); // 残りの目印を呼ぶ
+            startTime = -1; // 次の経路に備える
+            tracking.end();
+            xPID.reset();
+            yPID.reset();
+            stop();   // モータを全て停止
+            return 1; // 経路が無事実行されたことを示す
+        }
+        /// @brief 時間で媒介変数表示された経路を LQR で実行。参照状態の速度と角速度を前向き制御に使い、
+        /// 場の座標の位置と角度の偏差に、事前に求めた定常な利得を掛けて補う
+        /// @param trajectory 走る経路
+        /// @param gains trajectory から求めたホロノミック系の利得（gains.solve(trajectory)）
+        /// @return 実行の捗り（経過時間 / 計画された所要時間）
+        template <int N>
+        float follow(TimedTrajectory<N> &trajectory, const LQRGains<N, true> &gains) {
+            localize(); // 自己位置推定手法を更新
+            Pose current = predicted(); // 出力が効く時点の姿勢
+            if (startTime < 0) { // 初回の呼び出しで開始時間を記録
+              startTime = vex::timer::system();
+              tracking.begin(trajectory.duration, current.w);
+              trajectory.markers.reset();
+              trajectory.anchor(current); // 直線補間の軌道は現在の姿勢を始点とする
+            }
+            float t = (vex::timer::system() - startTime) / 1000; // 経過時間（秒）
+            if ( t < trajectory.duration ) { // 計画された時間が終わってない限り
+                TrajectoryState reference = trajectory.sample(t); // 現在時刻の参照状態
+                trajectory.markers.update( reference.dist, reference.dist / fmax(trajectory.length, SMALL), t ); // 通過した目印を呼ぶ
+                // 角度を制御しない軌道は実行を始めた時の角度を保つ
+                float target = trajectory.orientation ? reference.heading : tracking.initialHeading;
+                float omega = trajectory.orientation ? reference.omega : 0;
+                float heading = wrap(target, current.w);
+                Pose u = LQRGains<N, true>::correct(gains.at(t, trajectory.interval), current.x - reference.x, current.y - reference.y, heading / RadToDeg);
+                // 参照速度に補正を足して出力に直す
+                Vector translation { (reference.vx + u.x) / maxSpeed, (reference.vy + u.y) / maxSpeed };
+                // 反時計回りの角速度は負の回転出力となる
+                float w = -(omega + u.w * RadToDeg) / turnRate;
+                arcadeDrive( translation, w ); // コントローラ操作の関数に入力
+                Vector error = TrackError(current.x - reference.x, current.y - reference.y, Vector {reference.vx, reference.vy}.getAngle());
+                float speed = hypot(reference.vx, reference.vy);
+                lag = speed > SMALL ? -error.x / speed : 0; // 計画に対する遅れ
+                tracking.add( error.y, error.x, heading, t / trajectory.duration, saturated );
+                return t / trajectory.duration; //　実行捗りを毎回返す
+            }
+            trajectory.markers.finish(); // 残りの目印を呼ぶ
+            startTime = -1; // 次の経路に備える
+            tracking.end();
+            stop();   // モータを全て停止
+            return 1; // 経路が無事実行されたことを示す
+        }
+        /// @brief 手動操作の記録を再生。記録された姿勢を時間の参照状態とし、その差から求めた速度と角速度を前向き制御に使い、
+        /// 位置と角度の偏差をPID制御で補う（入力をそのまま流すのではないので、ずれても記録の経路に戻る）
+        /// @param replay 開いた記録（replay.open(filename)）
+        /// @return 実行の捗り（経過時間 / 記録の所要時間）
+        template <int B>
+        float follow(PoseReplay<B> &replay) {
+            localize(); // 自己位置推定手法を更新
+            Pose current = predicted(); // 出力が効く時点の姿勢
+            if (startTime < 0) { // 初回の呼び出しで開始時間を記録
+              startTime = vex::timer::system();
+              tracking.begin(replay.duration, current.w);
+            }
+            float t = (vex::timer::system() - startTime) / 1000; // 経過時間（秒）
+            TrajectoryState reference;
+            if ( replay.sample(t, reference) ) { // 記録が終わってない限り
+                // 記録の速度を出力に直したものに位置偏差の補正を足す
+                Vector translation {
+                    reference.vx / maxSpeed + xPID.get(current.x, reference.x),
+                    reference.vy / maxSpeed + yPID.get(current.y, reference.y)
+                };
+                // 反時計回りの角速度は負の回転出力となる
+                float w = -reference.omega / turnRate + omegaPID.get( wrap(current.w, reference.heading), 0);
+                // 進行方向の偏差を記録の速度で割り、記録に対する遅れを求める
+                float speed = hypot(reference.vx, reference.vy);
+                float along = ( (reference.x - current.x) * reference.vx + (reference.y - current.y) * reference.vy ) / fmax(speed, SMALL);
+                lag = speed > SMALL ? along / speed : 0;
+                arcadeDrive( translation, w ); // コントローラ操作の関数に入力
+                Vector error = TrackError(current.x - reference.x, current.y - reference.y, Vector {reference.vx, reference.vy}.getAngle());
+                float progress = replay.duration > SMALL ? fmin(t / replay.duration, 1) : 0;
+                tracking.add( error.y, error.x, wrap(reference.heading, current.w), progress, saturated );
+                return progress < 1 ? progress : 0.999; //　実行捗りを毎回返す（１は終わった時だけ）
+            }
+            replay.close();
+            startTime = -1; // 次の経路に備える
+            tracking.end();
+            xPID.reset();
+            yPID.reset();
+            stop();   // モータを全て停止
+            return 1; // 記録が無事再生されたことを示す
+        }
   };
 
 #endif
\ No newline at end of file
@@ -4,6 +4,7 @@
   #include "vex.h"
   #include <vector>
   #include <string>
+  #include "lib/Constants.h" //　数学定数とフィールドの寸法（SDK に依存しない）
 
   /* ロボットのポートID */
 
@@ -16,16 +17,6 @@
   const int encoderLeft_id = vex::PORT15;  //　左の車輪を図るエンコーダー
   const int encoderRear_id = vex::PORT10;  //　後ろの車輪を図るエンコーダー
 
-  /* 数学定数 */
-
-  const float PI = 3.14159265359; //　piの値
-  const float E = 2.71828182846;  //  Eの値
-  const float SMALL = 0.00001;    //  小さい値
-
-  /* 変換 */
-
-  const float RadToDeg = 180 / PI;  //　掛けて弧度法を度数法に・割って度数法を弧度法
-
   /* その他 */
 
   const int BAND = 3;
@@ -0,0 +1,173 @@
+#ifndef LQR
+#define LQR
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/Pose.h"
+  #include "lib/FixedVector.h"
+  #include "lib/Trajectory.h"
+  #include "lib/TimedTrajectory.h"
+
+  const int LQR_ITERATIONS = 1000; //　定常な利得を求める漸化式の最大の繰り返し数
+
+  /// @brief 3×3 の行列（追従誤差が３つ、入力が最大３つなので全てこの大きさで扱う）
+  struct Matrix3 {
+    float m[3][3];
+  };
+
+  /// @brief 対角行列
+  Matrix3 MatrixDiagonal(float a, float b, float c) {
+    return Matrix3 {{{a, 0, 0}, {0, b, 0}, {0, 0, c}}};
+  }
+
+  /// @brief 行列の積 A B
+  Matrix3 MatrixProduct(const Matrix3 &a, const Matrix3 &b) {
+    Matrix3 c;
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++)
+        c.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j];
+    return c;
+  }
+
+  /// @brief 行列の和 A + k B
+  Matrix3 MatrixSum(const Matrix3 &a, const Matrix3 &b, float k = 1) {
+    Matrix3 c;
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++) c.m[i][j] = a.m[i][j] + k * b.m[i][j];
+    return c;
+  }
+
+  /// @brief 転置行列
+  Matrix3 MatrixTranspose(const Matrix3 &a) {
+    Matrix3 c;
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++) c.m[i][j] = a.m[j][i];
+    return c;
+  }
+
+  /// @brief 逆行列（余因子による。Riccati 漸化式の R + B^T P B は正定値なので正則）
+  Matrix3 MatrixInverse(const Matrix3 &a) {
+    const float (*m)[3] = a.m;
+    Matrix3 c;
+    c.m[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    c.m[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+    c.m[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+    c.m[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    c.m[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+    c.m[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+    c.m[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    c.m[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+    c.m[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+    float det = m[0][0] * c.m[0][0] + m[0][1] * c.m[1][0] + m[0][2] * c.m[2][0];
+    float k = fabs(det) > SMALL * SMALL ? 1 / det : 0;
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++) c.m[i][j] *= k;
+    return c;
+  }
+
+  /// @brief 時間で媒介変数表示された軌道の各参照状態で車台の模型を線形化し、離散 Riccati 漸化式を終点から解いて
+  /// 最適なフィードバックの利得を保存するクラス。実行中は誤差に利得を掛けるだけ（積和９回）。
+  /// 非ホロノミック系の誤差は参照の前方向と左方向の位置の誤差と角度の誤差、入力は前進の速さと角速度の補正。
+  /// 模型が参照状態ごとに変わるので、利得を参照状態ごとに表に保存する。
+  /// ホロノミック系の誤差は場の座標の x、y の誤差と角度の誤差、入力は x、y の速度と角速度の補正。
+  /// 模型（A = I、B = dt I）が参照状態によらないので、漸化式が収束した定常な利得を一つだけ保存する。
+  /// 角度は弧度、距離はインチ、時間は秒で扱う
+  /// @tparam N 参照状態の数（TimedTrajectory と同じ）
+  /// @tparam H ホロノミック系の車台か
+  template <int N = TRAJECTORY_CAPACITY, bool H = false>
+  class LQRGains {
+    public:
+      static const bool holonomic = H; //　ホロノミック系の車台か
+      FixedVector<Matrix3, H ? 1 : N> gains; //　利得 K（入力の補正 = - K 誤差）。非ホロノミック系は参照状態ごと、ホロノミック系は定常な一つ
+      // 誤差の重み Q（許せる誤差の二乗の逆数）
+      float qAlong = 0.25;   //　進行方向（ホロノミック系は x）の位置の誤差（2インチ）
+      float qCross = 1;      //　横方向（ホロノミック系は y）の位置の誤差（1インチ）
+      float qHeading = 100;  //　角度の誤差（0.1弧度）
+      // 入力の重み R（許せる補正の二乗の逆数）
+      float rSpeed = 0.0025; //　前進（ホロノミック系は x、y）の速さの補正（20インチ毎秒）
+      float rTurn = 0.25;    //　角速度の補正（2弧度毎秒）
+    public:
+      /// @brief Riccati 漸化式を一段さかのぼる
+      /// @param A 誤差の運動
+      /// @param B 入力の効き
+      /// @param Q 誤差の重み
+      /// @param R 入力の重み
+      /// @param P 価値関数（一段前のものに書き換える）
+      /// @return この段の利得
+      static Matrix3 step(const Matrix3 &A, const Matrix3 &B, const Matrix3 &Q, const Matrix3 &R, Matrix3 &P) {
+          // K = (R + B^T P B)^-1 B^T P A、P = Q + A^T P (A - B K)
+          Matrix3 BtP = MatrixProduct(MatrixTranspose(B), P);
+          Matrix3 K = MatrixProduct(MatrixInverse(MatrixSum(R, MatrixProduct(BtP, B))), MatrixProduct(BtP, A));
+          P = MatrixSum(Q, MatrixProduct(MatrixProduct(MatrixTranspose(A), P), MatrixSum(A, MatrixProduct(B, K), -1)));
+          // 数値誤差で対称性が崩れないよう揃える
+          P = MatrixSum(P, MatrixTranspose(P));
+          for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++) P.m[r][c] /= 2;
+          return K;
+      }
+    public:
+      /// @brief 軌道に沿って利得を求める（読み込み時に一度だけ呼ぶ）
+      /// @param trajectory 時間で媒介変数表示された軌道
+      void solve(const TimedTrajectory<N> &trajectory) {
+          int n = trajectory.states.size();
+          float dt = trajectory.interval;
+          Matrix3 Q = MatrixDiagonal(qAlong, qCross, qHeading);
+          // 非ホロノミック系は横方向に直接動けないので、横方向の入力は B の列が０となり利得も０になる
+          Matrix3 R = MatrixDiagonal(rSpeed, H ? rSpeed : 1, rTurn);
+          Matrix3 B = MatrixDiagonal(dt, H ? dt : 0, dt);
+          Matrix3 P = Q; //　終点の価値関数
+          gains.clear();
+          if (H) {
+            // 模型が一定なので、利得が変わらなくなるまで漸化式を繰り返す（定常な利得）
+            Matrix3 A = MatrixDiagonal(1, 1, 1);
+            Matrix3 K = step(A, B, Q, R, P);
+            for (int i = 0; i < LQR_ITERATIONS; i++) {
+              Matrix3 next = step(A, B, Q, R, P);
+              float change = 0;
+              for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 3; c++) change = fmax(change, fabs(next.m[r][c] - K.m[r][c]));
+              K = next;
+              if (change < SMALL) break;
+            }
+            gains.push_back(K);
+            return;
+          }
+          for (int i = 0; i < n; i++) gains.push_back(MatrixDiagonal(0, 0, 0));
+          for (int i = n - 1; i >= 0; i--) {
+            const TrajectoryState &state = trajectory.states[i];
+            // 参照の前方向と左方向の座標での誤差の運動： ė_x = ω e_y + δv、ė_y = -ω e_x + v e_θ、ė_θ = δω
+            Matrix3 A = MatrixDiagonal(1, 1, 1);
+            float omega = state.omega / RadToDeg;
+            A.m[0][1] = omega * dt;
+            A.m[1][0] = -omega * dt;
+            A.m[1][2] = state.v * dt;
+            gains[i] = step(A, B, Q, R, P);
+          }
+      }
+      /// @brief ある時刻の利得（非ホロノミック系は最も近い参照状態のもの、ホロノミック系は定常な利得・solve を呼んでない場合は０の利得で補正しない）
+      /// @param t 経路開始からの時間（秒）
+      /// @param interval 参照状態の時間間隔（秒）
+      const Matrix3 &at(float t, float interval) const {
+          if (H) return gains.at(0);
+          return gains.at(interval > SMALL ? (int) (t / interval + 0.5) : 0);
+      }
+      /// @brief 誤差に利得を掛け、入力の補正を求める
+      /// @param K 利得
+      /// @param e0 誤差の一つ目
+      /// @param e1 誤差の二つ目
+      /// @param e2 角度の誤差（弧度）
+      /// @return 入力の補正（- K e）の三つの成分
+      static Pose correct(const Matrix3 &K, float e0, float e1, float e2) {
+          return Pose {
+            -(K.m[0][0] * e0 + K.m[0][1] * e1 + K.m[0][2] * e2),
+            -(K.m[1][0] * e0 + K.m[1][1] * e1 + K.m[1][2] * e2),
+            -(K.m[2][0] * e0 + K.m[2][1] * e1 + K.m[2][2] * e2)
+          };
+      }
+  };
+
+  typedef LQRGains<TRAJECTORY_CAPACITY, false> DifferentialLQRGains; //　既定の容量（参照状態100個）の非ホロノミック系の利得
+  typedef LQRGains<TRAJECTORY_CAPACITY, true> HolonomicLQRGains;     //　ホロノミック系の定常な利得
+
+#endif
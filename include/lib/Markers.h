@@ -0,0 +1,117 @@
+#ifndef MARKERS
+#define MARKERS
+
+  #include "lib/Include.h"
+
+  const int MARKER_CAPACITY = 8; //　一つの軌道に付けられる目印の既定の最大数
+
+  /// @brief 目印の位置の単位を選択できる列挙型
+  /// @param atDistance 経路の始点からの距離（インチ）
+  /// @param atFraction 経路の長さに対する割合（0から1）
+  /// @param atTime 計画上の経過時間（秒）
+  enum MarkerUnit { atDistance, atFraction, atTime };
+
+  /// @brief 目印を通過した時に呼ばれる関数
+  /// @param id 目印の番号（add の戻り値）
+  typedef void (*MarkerCallback)(int id);
+
+  /// @brief 経路上の目印
+  /// @param unit 位置の単位
+  /// @param position 位置
+  /// @param callback 通過した時に呼ぶ関数（NULL なら fired の旗だけ立てる）
+  /// @param id 目印の番号
+  /// @param fired 今回の実行で通過したか
+  struct Marker {
+    MarkerUnit unit;
+    float position;
+    MarkerCallback callback;
+    int id;
+    bool fired;
+  };
+
+  /// @brief 軌道に付ける目印の一覧。目印は単位ごとに位置の順に並べ、単位ごとの探索位置から先だけを調べるので、
+  /// 一周期の処理は通過した目印の数だけで済む（目印の総数によらない）。
+  /// 一周期に複数の目印を越えても全て順に一度ずつ呼び、捗りが戻っても探索位置は戻らないので二度呼ぶことはない
+  /// @tparam N 目印の最大数
+  template <int N = MARKER_CAPACITY>
+  class MarkerList {
+    private:
+      Marker markers[N];           //　単位、位置の順に並んだ目印
+      int count = 0;               //　目印の数
+      int sizes[3] = {0, 0, 0};    //　単位ごとの目印の数
+      int cursors[3] = {0, 0, 0};  //　単位ごとの次に調べる目印（単位の中での番号）
+    private:
+      /// @brief 単位の最初の目印の番号
+      int start(int unit) const {
+          int i = 0;
+          for (int u = 0; u < unit; u++) i += sizes[u];
+          return i;
+      }
+      /// @brief 一つの単位の目印を現在の位置まで進めて呼ぶ
+      /// @return 呼んだ目印の数
+      int advance(int unit, float position) {
+          int first = start(unit);
+          int fired = 0;
+          while (cursors[unit] < sizes[unit] && markers[first + cursors[unit]].position <= position) {
+            Marker &marker = markers[first + cursors[unit]++];
+            marker.fired = true;
+            if (marker.callback != NULL) marker.callback(marker.id);
+            fired++;
+          }
+          return fired;
+      }
+    public:
+      /// @brief 目印を加える
+      /// @param unit 位置の単位
+      /// @param position 位置
+      /// @param callback 通過した時に呼ぶ関数（NULL なら fired の旗だけ立てる）
+      /// @return 目印の番号（加えられない場合 ー１）
+      int add(MarkerUnit unit, float position, MarkerCallback callback = NULL) {
+          if (count >= N) return -1;
+          // 単位、位置の順を保つよう挿入（同じ位置は加えた順）
+          int i = count;
+          while (i > 0 && (markers[i - 1].unit > unit || (markers[i - 1].unit == unit && markers[i - 1].position > position))) {
+            markers[i] = markers[i - 1];
+            i--;
+          }
+          markers[i] = Marker {unit, position, callback, count, false};
+          sizes[unit]++;
+          return count++;
+      }
+      /// @brief 目印を全て消す
+      void clear() {
+          count = 0;
+          sizes[0] = sizes[1] = sizes[2] = 0;
+          cursors[0] = cursors[1] = cursors[2] = 0;
+      }
+      /// @brief 実行の始めに全ての目印を未通過に戻す
+      void reset() {
+          for (int i = 0; i < count; i++) markers[i].fired = false;
+          cursors[0] = cursors[1] = cursors[2] = 0;
+      }
+      /// @brief 現在の位置までの目印を呼ぶ（経路実行の周期ごとに呼ぶ）
+      /// @param distance 経路の始点からの距離（インチ）
+      /// @param fraction 経路の長さに対する割合（0から1）
+      /// @param time 計画上の経過時間（秒）
+      /// @return 今回呼んだ目印の数
+      int update(float distance, float fraction, float time) {
+          return advance(atDistance, distance) + advance(atFraction, fraction) + advance(atTime, time);
+      }
+      /// @brief 残りの目印を全て呼ぶ（経路の終わりで呼ぶ）
+      /// @return 今回呼んだ目印の数
+      int finish() {
+          return advance(atDistance, INFINITY) + advance(atFraction, INFINITY) + advance(atTime, INFINITY);
+      }
+      /// @brief 目印を今回の実行で通過したか
+      /// @param id 目印の番号
+      bool fired(int id) const {
+          for (int i = 0; i < count; i++) if (markers[i].id == id) return markers[i].fired;
+          return false;
+      }
+      /// @brief 目印の数
+      int size() const {
+          return count;
+      }
+  };
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef PATH_PROGRESS
+#define PATH_PROGRESS
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/Pose.h"
+  #include "lib/Trajectory.h"
+  #include "lib/TimedTrajectory.h"
+  #include "lib/CompactTrajectory.h"
+
+  /// @brief 軌道の経由地の数
+  template <class T>
+  int WaypointCount(const T &trajectory) {
+    return trajectory.waypoints.size();
+  }
+
+  /// @brief 圧縮軌道の経由地の数
+  template <int N, bool H>
+  int WaypointCount(const BasicCompactTrajectory<N, H> &trajectory) {
+    return trajectory.size();
+  }
+
+  /// @brief 経由地 i - 1 から経由地 i までの距離（インチ・i が０の場合は始点から）
+  template <class T>
+  float SegmentLength(const T &trajectory, int i) {
+    return fmax(trajectory.waypoints[i].dist - (i > 0 ? trajectory.waypoints[i - 1].dist : 0), 0);
+  }
+
+  /// @brief 圧縮軌道の経由地 i - 1 から経由地 i までの距離
+  template <int N, bool H>
+  float SegmentLength(const BasicCompactTrajectory<N, H> &trajectory, int i) {
+    return trajectory.segment(i);
+  }
+
+  /// @brief 圧縮軌道の経由地の進行方向（角度）
+  template <int N, bool H>
+  float TravelAngle(const BasicCompactTrajectory<N, H> &trajectory, int i) {
+    return trajectory.travelAngle(i);
+  }
+
+  /// @brief 経由地 i の速度の出力の大きさ
+  template <class T>
+  float WaypointSpeed(const T &trajectory, int i) {
+    const Pose &heading = trajectory.waypoints[i].heading;
+    return hypot(heading.x, heading.y);
+  }
+
+  /// @brief 圧縮軌道の経由地 i の速度の出力の大きさ
+  template <int N, bool H>
+  float WaypointSpeed(const BasicCompactTrajectory<N, H> &trajectory, int i) {
+    return trajectory.speed(i);
+  }
+
+  /// @brief 経由地 i - 1 から経由地 i までの計画上の所要時間に最高速度を掛けたもの（両端の速度の平均で割る）
+  template <class T>
+  float SegmentSchedule(const T &trajectory, int i) {
+    float speed = (WaypointSpeed(trajectory, i > 0 ? i - 1 : 0) + WaypointSpeed(trajectory, i)) / 2;
+    return SegmentLength(trajectory, i) / fmax(speed, 0.01);
+  }
+
+  /// @brief ホロノミック系の軌道か
+  template <class T>
+  bool IsHolonomic(const T &trajectory) {
+    return T::holonomic;
+  }
+
+  /// @brief 現在の区間の経由地（経由地の配列を持つ軌道は番号で直接引く）
+  template <class T>
+  Waypoint ReferenceWaypoint(T &trajectory, int i, float dist) {
+    return trajectory.waypoints[i];
+  }
+
+  /// @brief 圧縮軌道の現在の区間の経由地（探索位置を保持する get で引く）
+  template <int N, bool H>
+  Waypoint ReferenceWaypoint(BasicCompactTrajectory<N, H> &trajectory, int i, float dist) {
+    return trajectory.get(dist);
+  }
+
+  /// @brief ロボットの位置を軌道に射影して捗りを求めるクラス。
+  /// 経由地は位置を持たないので、始点から各区間の弦の向きに区間の距離だけ進んで区間の端点を求める。
+  /// 前回の区間の前後 WINDOW 個の区間だけを探すので、一回の更新は経由地の数によらず O(WINDOW)。
+  /// 直線補間の軌道は相対的な動きなので、実行を始めた時のロボットの姿勢を始点とする。
+  /// @tparam WINDOW 前後に探す区間の数
+  template <int WINDOW = 8>
+  class PathProgress {
+    private:
+      float offset = 0;   //　進行方向に足す角度（非ホロノミック系の直線補間は開始時のロボットの角度に合わせる）
+      float startX = 0;   //　現在の区間の始点の x 値
+      float startY = 0;   //　現在の区間の始点の y 値
+      float startDist = 0; //　現在の区間の始点までの距離
+      float startSchedule = 0; //　現在の区間の始点までの計画上の所要時間（最高速度を掛けたもの）
+    public:
+      bool active = false;   //　実行中か（begin から reset まで）
+      bool finished = false; //　最後の区間の終点を越えたか
+      int index = 0;         //　現在の区間（終点の経由地の番号）
+      float distance = 0;    //　射影した点までの軌道上の距離（インチ）
+      float crossTrack = 0;  //　軌道からの横方向の距離（インチ・進行方向の左が正）
+      float schedule = 0;    //　射影した点までの計画上の所要時間に最高速度を掛けたもの（インチ・最高速度で割ると秒）
+      float total = 0;       //　軌道全体の計画上の所要時間に最高速度を掛けたもの
+    private:
+      /// @brief 区間 i の弦の向きの単位ベクトル（両端の経由地の接線の中間）
+      template <class T>
+      Vector direction(const T &trajectory, int i) const {
+          float angle = TravelAngle(trajectory, i);
+          return Vector {ChordAngle(i > 0 ? TravelAngle(trajectory, i - 1) : angle, angle) + offset};
+      }
+    public:
+      /// @brief 実行を始める
+      /// @param trajectory 軌道
+      /// @param pose 開始時のロボットの姿勢
+      template <class T>
+      void begin(const T &trajectory, const Pose &pose) {
+          bool relative = trajectory.type == linear;
+          startX = relative ? pose.x : trajectory.initialPose.x;
+          startY = relative ? pose.y : trajectory.initialPose.y;
+          offset = relative && !IsHolonomic(trajectory) ? pose.w - trajectory.initialPose.w : 0;
+          startDist = 0;
+          startSchedule = 0;
+          index = 0;
+          distance = 0;
+          schedule = 0;
+          total = 0;
+          for (int i = 0; i < WaypointCount(trajectory); i++) total += SegmentSchedule(trajectory, i);
+          crossTrack = 0;
+          finished = false;
+          active = true;
+      }
+      /// @brief 実行を終える
+      void reset() {
+          active = false;
+      }
+      /// @brief ロボットの位置を前回の区間の近くに射影し、捗りを更新する
+      /// @param trajectory 軌道
+      /// @param pose ロボットの姿勢
+      /// @return 射影した点までの軌道上の距離（インチ）
+      template <class T>
+      float update(const T &trajectory, const Pose &pose) {
+          if (!active) begin(trajectory, pose);
+          int n = WaypointCount(trajectory);
+          // 前の区間へ戻りながら始点を求める（区間の端点は前の端点から弦の向きに区間の距離だけ進んだ位置）
+          int first = index;
+          float x = startX, y = startY, dist = startDist, time = startSchedule;
+          while (first > 0 && first > index - WINDOW) {
+            first--;
+            float length = SegmentLength(trajectory, first);
+            Vector unit = direction(trajectory, first);
+            x -= unit.x * length;
+            y -= unit.y * length;
+            dist -= length;
+            time -= SegmentSchedule(trajectory, first);
+          }
+          // 窓の中の区間に射影し、一番近い点を探す（窓の終わりは探す前に決め、見つけるたびに窓を広げない）
+          int last = index + WINDOW < n - 1 ? index + WINDOW : n - 1;
+          float best = -1;
+          for (int i = first; i <= last; i++) {
+            float length = SegmentLength(trajectory, i);
+            float duration = SegmentSchedule(trajectory, i);
+            Vector unit = direction(trajectory, i);
+            float dx = pose.x - x, dy = pose.y - y;
+            float along = dx * unit.x + dy * unit.y;                      //　区間の始点からの進行方向の距離
+            float t = length > SMALL ? fitToRange(along, 0, length) : 0; //　区間内に制限
+            float ex = dx - unit.x * t, ey = dy - unit.y * t;
+            float gap = ex * ex + ey * ey;
+            if (best < 0 || gap < best) {
+              best = gap;
+              index = i;
+              startX = x;
+              startY = y;
+              startDist = dist;
+              startSchedule = time;
+              distance = dist + t;
+              schedule = time + (length > SMALL ? duration * t / length : 0);
+              crossTrack = unit.x * dy - unit.y * dx; //　進行方向の左が正
+              finished = i == n - 1 && along >= length; //　最後の区間の終点を越えた
+            }
+            x += unit.x * length;
+            y += unit.y * length;
+            dist += length;
+            time += duration;
+          }
+          return distance;
+      }
+  };
+
+#endif
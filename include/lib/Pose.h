@@ -1,7 +1,7 @@
 #ifndef POSE 
 #define POSE
 
-  #include "lib/Include.h"
+  #include "lib/Constants.h"
   #include "lib/Helpers.h"
   #include "lib/Vector.h"
 
@@ -0,0 +1,135 @@
+#ifndef POSE_HISTORY
+#define POSE_HISTORY
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/Pose.h"
+  #include <stdint.h>
+
+  /// @brief 自己位置推定の一回分の記録
+  /// @param time 記録した時間（ミリ秒）
+  /// @param pose ロボットの姿勢
+  /// @param velocity ロボットの速度（インチ毎秒・一般視点）
+  /// @param omega ロボットの角速度（度毎秒）
+  /// @param command その時点で最後に出した横断出力の大きさ（0から1）
+  struct PoseRecord {
+    uint32_t time;
+    Pose pose;
+    Vector velocity;
+    float omega;
+    float command;
+  };
+
+  /// @brief 姿勢と出力の履歴を保持する固定長のリングバッファ。
+  /// センサの遅れとモータの反応の遅れを補うため、姿勢を遅れの分だけ先に予測し、
+  /// 遅れて届いた外部の測定値（カメラなど）で過去の姿勢を修正して現在まで再生する。
+  /// @tparam N 記録の数（10ミリ秒ごとなら32で320ミリ秒分）
+  template <int N = 32>
+  class PoseHistory {
+    private:
+      PoseRecord records[N]; //　記録の配列
+      int head = 0;          //　次に書き込む位置
+      int count = 0;         //　記録の数
+    public:
+      /// @brief 新しい記録を追加（一番古い記録を上書き）
+      /// @param record 追加する記録
+      void push(const PoseRecord &record) {
+          records[head] = record;
+          head = (head + 1) % N;
+          if (count < N) count++;
+      }
+      /// @brief 記録を全て消す
+      void clear() {
+          count = 0;
+          head = 0;
+      }
+      /// @brief 記録の数
+      int size() const {
+          return count;
+      }
+      /// @brief 新しい方から数えて i 番目の記録（０が最新）
+      PoseRecord &recent(int i) {
+          return records[(head - 1 - i + 2 * N) % N];
+      }
+      /// @brief 最新の記録から遅れの分だけ先の姿勢を等速運動で予測。
+      /// 最新の記録が既に古くなっている分（自己位置推定の更新が遅れた場合）も足して先に進める
+      /// @param latency 遅れ（ミリ秒）
+      /// @param now 現在の時刻（ミリ秒）
+      /// @return 予測された姿勢（記録がなければ原点）
+      Pose predict(float latency, uint32_t now) {
+          if (count == 0) return Pose {0, 0, 0};
+          const PoseRecord &last = recent(0);
+          float age = now > last.time ? now - last.time : 0; //　最新の記録からの経過時間（ミリ秒）
+          float t = (age + latency) / 1000;
+          return Pose {
+            last.pose.x + last.velocity.x * t,
+            last.pose.y + last.velocity.y * t,
+            bound(last.pose.w + last.omega * t)
+          };
+      }
+      /// @brief 過去のある時刻の姿勢を前後の記録から線形補間で求める
+      /// @param time 時刻（ミリ秒）
+      /// @param pose 求めた姿勢の代入先
+      /// @return その時刻が履歴の範囲内か
+      bool at(uint32_t time, Pose &pose) {
+          for (int i = 0; i < count - 1; i++) {
+            const PoseRecord &newer = recent(i);
+            const PoseRecord &older = recent(i + 1);
+            if (older.time > time) continue;
+            float span = newer.time - older.time;
+            float u = span > 0 ? fitToRange((time - older.time) / span, 0, 1) : 1;
+            pose.x = older.pose.x + (newer.pose.x - older.pose.x) * u;
+            pose.y = older.pose.y + (newer.pose.y - older.pose.y) * u;
+            pose.w = bound(older.pose.w - wrap(newer.pose.w, older.pose.w) * u);
+            return true;
+          }
+          return false;
+      }
+      /// @brief 遅れて届いた位置の測定値で現在の姿勢を修正する。
+      /// 測定した時刻の推定位置と測定値の差を求め、その時刻以降の移動量（オドメトリ）はそのまま再生するので、
+      /// 現在の位置と測定時刻より新しい記録に同じ差を足すことになる。角度はジャイロを信頼し修正しない。
+      /// @param current 現在の姿勢
+      /// @param measured 測定された位置
+      /// @param time 測定した時刻（ミリ秒）
+      /// @param gain 修正の割合（１で測定値を完全に信頼）
+      /// @return 修正された現在の姿勢（測定時刻が履歴の範囲外なら修正しない）
+      Pose correct(Pose current, Vector measured, uint32_t time, float gain = 1) {
+          Pose past;
+          if (!at(time, past)) return current;
+          float dx = (measured.x - past.x) * gain;
+          float dy = (measured.y - past.y) * gain;
+          // 測定時刻より新しい記録も修正し、次の測定で同じ差を二重に足さないよう
+          for (int i = 0; i < count; i++) {
+            PoseRecord &record = recent(i);
+            if (record.time < time) break;
+            record.pose.x += dx;
+            record.pose.y += dy;
+          }
+          current.x += dx;
+          current.y += dy;
+          return current;
+      }
+      /// @brief 出力と実際の速度の履歴を比べ、遅れを測定する。
+      /// 出力を k 回分遅らせた時に速度と最も一致する k を探す（ロボットが加減速している時に呼ぶこと）
+      /// @param maxSpeed 横断出力１の時のロボットの速度（インチ毎秒）
+      /// @return 測定された遅れ（ミリ秒）。記録が足りなければ０
+      float measureLatency(float maxSpeed) {
+          if (count < 4) return 0;
+          int best = 0;
+          float bestError = -1;
+          for (int k = 0; k < count / 2; k++) {
+            float error = 0;
+            for (int i = 0; i + k < count; i++) {
+              float difference = recent(i + k).command * maxSpeed - recent(i).velocity.getMagnitude();
+              error += difference * difference;
+            }
+            error /= count - k;
+            if (bestError < 0 || error < bestError) { bestError = error; best = k; }
+          }
+          float span = recent(0).time - recent(count - 1).time;
+          return best * span / (count - 1); //　記録の平均間隔を掛ける
+      }
+  };
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef POWER_MANAGER
+#define POWER_MANAGER
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+
+  const int POWER_MOTORS = 16;        //　登録できるモータの最大数
+  const float MOTOR_RATED_CURRENT = 2.5; //　V5 モータの最大電流（アンペア）
+
+  /// @brief 電力管理に登録されたモータの状態（テレメトリ用）
+  /// @param motor モータ
+  /// @param priority 優先度（大きいほど先に電流を割り当てる）
+  /// @param temperature 温度（摂氏）
+  /// @param current 電流（アンペア）
+  /// @param efficiency 効率（パーセント）
+  /// @param thermal 温度による出力の比率（0から1）
+  /// @param limit 割り当てた電流の上限（アンペア）
+  /// @param scale 速度命令に掛ける比率（滑らかに変化する・0から1）
+  /// @param stalled 大電流なのに効率が低い（止まっている）
+  struct MotorStatus {
+    vex::motor *motor;
+    int priority;
+    float temperature;
+    float current;
+    float efficiency;
+    float thermal;
+    float limit;
+    float scale;
+    bool stalled;
+  };
+
+  /// @brief モータの温度と電流を監視し、V5 モータが自ら出力を落とす前に滑らかに出力を下げるクラス。
+  /// 全体の電流の予算を優先度の高いモータから割り当て、各モータの電流の上限と速度命令の比率を決める
+  class PowerManager {
+    public:
+      MotorStatus motors[POWER_MOTORS]; //　登録されたモータの状態
+      int count = 0;                    //　登録されたモータの数
+      float budget = 20;         //　全体の電流の予算（アンペア）
+      float warmTemperature = 45; //　出力を下げ始める温度（摂氏）
+      float hotTemperature = 55;  //　V5 モータが出力を落とし始める温度（摂氏）。この温度で minimumScale になる
+      float minimumScale = 0.3;   //　温度による出力の比率の下限
+      float smoothing = 0.1;      //　更新ごとに比率が目標に近づく割合（0から1）
+      float total = 0;            //　全体の電流（アンペア）
+      float hottest = 0;          //　一番熱いモータの温度（摂氏）
+    public:
+      /// @brief モータを登録する
+      /// @param motor モータ
+      /// @param priority 優先度（大きいほど先に電流を割り当てる）
+      /// @return 登録の番号（登録できない場合 ー１）
+      int add(vex::motor &motor, int priority = 0) {
+          if (count >= POWER_MOTORS) return -1;
+          motors[count] = MotorStatus {&motor, priority, 0, 0, 0, 1, MOTOR_RATED_CURRENT, 1, false};
+          return count++;
+      }
+      /// @brief 連続して登録したモータの速度命令の比率（一番低いもの）。
+      /// 車台の車輪は同じ比率で下げないと進む向きが変わるので、まとめて問う
+      /// @param first 最初の登録の番号
+      /// @param n モータの数
+      float scale(int first, int n) const {
+          float k = 1;
+          for (int i = first; i < first + n && i < count; i++) if (i >= 0) k = fmin(k, motors[i].scale);
+          return k;
+      }
+      /// @brief 全てのモータを測定し、電流の上限と速度命令の比率を更新する（周期的に呼ぶ）
+      void update() {
+          total = 0;
+          hottest = 0;
+          for (int i = 0; i < count; i++) {
+            MotorStatus &m = motors[i];
+            m.temperature = m.motor -> temperature(vex::temperatureUnits::celsius);
+            m.current = m.motor -> current(vex::currentUnits::amp);
+            m.efficiency = m.motor -> efficiency(vex::percentUnits::pct);
+            m.stalled = m.current > 0.8 * MOTOR_RATED_CURRENT && m.efficiency < 10;
+            // 温かくなり始めたら直線的に下げ、V5 モータが出力を落とす温度で下限にする
+            float heat = (m.temperature - warmTemperature) / fmax(hotTemperature - warmTemperature, SMALL);
+            m.thermal = fitToRange(1 - heat * (1 - minimumScale), minimumScale, 1);
+            total += m.current;
+            hottest = fmax(hottest, m.temperature);
+          }
+          // 優先度の高い順に電流を割り当てる。同じ優先度のモータの上限の合計が残りを超える場合は比例的に分ける。
+          // 次の優先度には実際に流れている電流だけを差し引いた残りを回す
+          float remaining = budget;
+          int done = 0;
+          bool assigned[POWER_MOTORS] = {false};
+          while (done < count) {
+            int level = -2147483647;
+            for (int i = 0; i < count; i++) if (!assigned[i] && motors[i].priority > level) level = motors[i].priority;
+            float caps = 0, used = 0;
+            for (int i = 0; i < count; i++) {
+              if (assigned[i] || motors[i].priority != level) continue;
+              caps += MOTOR_RATED_CURRENT * motors[i].thermal;
+              used += motors[i].current;
+            }
+            float share = caps > remaining ? fmax(remaining, 0) / caps : 1;
+            for (int i = 0; i < count; i++) {
+              if (assigned[i] || motors[i].priority != level) continue;
+              MotorStatus &m = motors[i];
+              m.limit = MOTOR_RATED_CURRENT * m.thermal * share;
+              m.motor -> setMaxTorque(m.limit, vex::currentUnits::amp);
+              // 速度命令の比率は上限の比率に滑らかに近づける
+              m.scale += (m.limit / MOTOR_RATED_CURRENT - m.scale) * smoothing;
+              assigned[i] = true;
+              done++;
+            }
+            remaining -= fmin(used, caps * share);
+          }
+      }
+  };
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef RECORDING
+#define RECORDING
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/Pose.h"
+  #include "lib/TimedTrajectory.h"
+  #include "lib/DriverInput.h"
+  #include <stdint.h>
+  #include <stdio.h>
+
+  const int RECORDING_BUFFER = 256;       //　SDカードとの読み書きの既定のバッファ（バイト）
+  const int RECORD_FIELDS = 7;            //　一コマの値の数（時間、x、y、角度、入力三つ）
+  const int RECORD_HEADER = 12;           //　ファイルの先頭の大きさ（識別子、コマ数、所要時間）
+  const int RECORD_FRAME_MAX = RECORD_FIELDS * 5; //　一コマの最大の大きさ（可変長整数は最大５バイト）
+  const float POSITION_SCALE = 100;       //　位置の量子化（0.01インチ単位）
+  const float HEADING_SCALE = 100;        //　角度の量子化（0.01度単位）
+  const int HEADING_STEPS = 36000;        //　一周の角度の量子化の数
+  const float INPUT_SCALE = AXIS_MAX;     //　入力の量子化（ジョイスティックと同じ分解能）
+  const char RECORD_MAGIC[4] = {'R', 'P', 'L', 'Y'}; //　ファイルの識別子
+
+  /// @brief 記録の一コマ
+  /// @param time 記録を始めてからの時間（ミリ秒）
+  /// @param pose ロボットの姿勢
+  /// @param input 応答曲線を施したコントローラ入力（x が横、y が前、w が回転・ー１から１）
+  struct RecordFrame {
+    uint32_t time;
+    Pose pose;
+    Pose input;
+  };
+
+  /// @brief 符号付き整数を０に近いほど小さい符号なし整数に写す（ー１→１、１→２、ー２→３）
+  uint32_t ZigZag(int32_t value) {
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+  }
+
+  /// @brief ZigZag の逆
+  int32_t UnZigZag(uint32_t value) {
+    return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+  }
+
+  /// @brief 32ビットの値を先頭に書く（リトルエンディアン）
+  void PutWord(uint8_t *bytes, uint32_t value) {
+    for (int i = 0; i < 4; i++) bytes[i] = (value >> (8 * i)) & 0xFF;
+  }
+
+  /// @brief 32ビットの値を先頭から読む（リトルエンディアン）
+  uint32_t GetWord(const uint8_t *bytes) {
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+  }
+
+  /// @brief 一コマを量子化する（角度は０から HEADING_STEPS - 1）
+  void QuantizeFrame(const RecordFrame &frame, int32_t *values) {
+    values[0] = frame.time;
+    values[1] = lround(frame.pose.x * POSITION_SCALE);
+    values[2] = lround(frame.pose.y * POSITION_SCALE);
+    values[3] = lround(bound(frame.pose.w) * HEADING_SCALE) % HEADING_STEPS;
+    values[4] = lround(fitToRange(frame.input.x, -1, 1) * INPUT_SCALE);
+    values[5] = lround(fitToRange(frame.input.y, -1, 1) * INPUT_SCALE);
+    values[6] = lround(fitToRange(frame.input.w, -1, 1) * INPUT_SCALE);
+  }
+
+  /// @brief ドライバー操作の姿勢と入力を差分符号化してSDカードに流し込むクラス。
+  /// 各コマは前のコマとの差を ZigZag と可変長整数で書くので、10ミリ秒ごとの記録でも一コマ７バイト程度になる。
+  /// 量子化した値の差を書くので復号しても誤差は蓄積しない。固定長のバッファが埋まるたびに書き出すので、
+  /// 記録がどれだけ長くてもメモリの使用量は変わらない
+  /// @tparam B バッファの大きさ（バイト）
+  template <int B = RECORDING_BUFFER>
+  class PoseRecorder {
+    static_assert(B >= RECORD_HEADER && B >= RECORD_FRAME_MAX, "buffer must hold a header and a frame");
+    private:
+      FILE *file = NULL;           //　書き込み中のファイル
+      uint8_t buffer[B];           //　書き出し前のバイト
+      int used = 0;                //　バッファの使用量
+      int32_t last[RECORD_FIELDS]; //　前のコマの量子化した値
+      uint32_t startTime = 0;      //　記録を始めた時間（ミリ秒）
+    public:
+      uint32_t frames = 0;   //　記録したコマ数
+      uint32_t bytes = 0;    //　書き出したバイト数
+      bool recording = false; //　記録中か
+    private:
+      /// @brief バッファを書き出す
+      /// @return 書き出せたか
+      bool flush() {
+          if (used > 0 && fwrite(buffer, 1, used, file) != (size_t) used) return false;
+          bytes += used;
+          used = 0;
+          return true;
+      }
+      /// @brief 可変長整数をバッファに加える（７ビットずつ、続きがあれば最上位ビットを立てる）
+      void put(uint32_t value) {
+          while (value >= 0x80) {
+            buffer[used++] = (value & 0x7F) | 0x80;
+            value >>= 7;
+          }
+          buffer[used++] = value;
+      }
+      /// @brief 書き込みに失敗した時にファイルを閉じる
+      bool fail() {
+          fclose(file);
+          file = NULL;
+          recording = false;
+          return false;
+      }
+    public:
+      /// @brief 記録を始める（既存のファイルは上書き）
+      /// @param filename ファイル名
+      /// @return 始められたか（SDカードが入ってない場合は false）
+      bool begin(const char *filename) {
+          if (recording) end();
+          if (!Brain.SDcard.isInserted()) return false;
+          file = fopen(filename, "wb");
+          if (file == NULL) return false;
+          // コマ数と所要時間は end で書き直す
+          for (int i = 0; i < 4; i++) buffer[i] = RECORD_MAGIC[i];
+          PutWord(buffer + 4, 0);
+          PutWord(buffer + 8, 0);
+          used = RECORD_HEADER;
+          bytes = 0;
+          frames = 0;
+          for (int i = 0; i < RECORD_FIELDS; i++) last[i] = 0;
+          startTime = vex::timer::system();
+          recording = true;
+          return true;
+      }
+      /// @brief 一コマを記録する（手動操作の制御周期ごとに呼ぶ）
+      /// @param pose ロボットの姿勢
+      /// @param x 応答曲線を施した横の入力（ー１から１）
+      /// @param y 応答曲線を施した前の入力（ー１から１）
+      /// @param w 応答曲線を施した回転の入力（ー１から１）
+      /// @return 記録できたか
+      bool add(const Pose &pose, float x, float y, float w) {
+          if (!recording) return false;
+          int32_t values[RECORD_FIELDS];
+          QuantizeFrame(RecordFrame {vex::timer::system() - startTime, pose, Pose {x, y, w}}, values);
+          if (used + RECORD_FRAME_MAX > B && !flush()) return fail();
+          for (int i = 0; i < RECORD_FIELDS; i++) {
+            int32_t delta = values[i] - last[i];
+            if (i == 3) { // 角度は短い方向の差
+              if (delta > HEADING_STEPS / 2) delta -= HEADING_STEPS;
+              if (delta < -HEADING_STEPS / 2) delta += HEADING_STEPS;
+            }
+            put(ZigZag(delta));
+            last[i] = values[i];
+          }
+          frames++;
+          return true;
+      }
+      /// @brief 記録を終え、ファイルの先頭にコマ数と所要時間を書いて閉じる
+      /// @return 保存できたか
+      bool end() {
+          if (!recording) return false;
+          if (!flush()) return fail();
+          uint8_t header[8];
+          PutWord(header, frames);
+          PutWord(header + 4, frames > 0 ? last[0] : 0);
+          bool written = fseek(file, 4, SEEK_SET) == 0 && fwrite(header, 1, 8, file) == 8;
+          fclose(file);
+          file = NULL;
+          recording = false;
+          return written;
+      }
+  };
+
+  /// @brief PoseRecorder の記録をSDカードから少しずつ読み、記録された姿勢を時間の参照状態として返すクラス。
+  /// 読むのは現在の時刻を挟む二コマだけなので、記録の長さによらずメモリの使用量は変わらない
+  /// @tparam B バッファの大きさ（バイト）
+  template <int B = RECORDING_BUFFER>
+  class PoseReplay {
+    static_assert(B >= RECORD_HEADER, "buffer must hold a header");
+    private:
+      FILE *file = NULL;           //　読み込み中のファイル
+      uint8_t buffer[B];           //　読み込んだバイト
+      int used = 0;                //　バッファの読んだ位置
+      int filled = 0;              //　バッファの有効なバイト数
+      int32_t last[RECORD_FIELDS]; //　前のコマの量子化した値
+      uint32_t remaining = 0;      //　まだ読んでないコマ数
+      float dist = 0;              //　previous までの記録された移動距離（インチ）
+    public:
+      RecordFrame previous; //　現在の時刻以前の最後のコマ
+      RecordFrame next;     //　現在の時刻より後の最初のコマ
+      uint32_t frames = 0;  //　記録のコマ数
+      float duration = 0;   //　記録の所要時間（秒）
+      bool opened = false;  //　読み込み中か
+    private:
+      /// @brief 一バイト読む（バッファが空なら読み足す）
+      bool get(uint8_t &byte) {
+          if (used >= filled) {
+            filled = fread(buffer, 1, B, file);
+            used = 0;
+            if (filled <= 0) return false;
+          }
+          byte = buffer[used++];
+          return true;
+      }
+      /// @brief 可変長整数を読む
+      bool get(uint32_t &value) {
+          value = 0;
+          uint8_t byte = 0x80;
+          for (int shift = 0; byte & 0x80; shift += 7) {
+            if (shift > 28 || !get(byte)) return false;
+            value |= (uint32_t) (byte & 0x7F) << shift;
+          }
+          return true;
+      }
+      /// @brief 次のコマを復号する
+      bool decode(RecordFrame &frame) {
+          if (remaining == 0) return false;
+          for (int i = 0; i < RECORD_FIELDS; i++) {
+            uint32_t value;
+            if (!get(value)) return false;
+            last[i] += UnZigZag(value);
+          }
+          last[3] = ((last[3] % HEADING_STEPS) + HEADING_STEPS) % HEADING_STEPS;
+          remaining--;
+          frame.time = last[0];
+          frame.pose = Pose {last[1] / POSITION_SCALE, last[2] / POSITION_SCALE, last[3] / HEADING_SCALE};
+          frame.input = Pose {last[4] / INPUT_SCALE, last[5] / INPUT_SCALE, last[6] / INPUT_SCALE};
+          return true;
+      }
+      /// @brief 最初のコマの前に戻る
+      bool rewind() {
+          used = filled = 0;
+          dist = 0;
+          for (int i = 0; i < RECORD_FIELDS; i++) last[i] = 0;
+          return fseek(file, RECORD_HEADER, SEEK_SET) == 0;
+      }
+      /// @brief 先頭のコマ数が０の記録（end を呼ぶ前に止まったもの）を終わりまで読み、コマ数と所要時間を求める。
+      /// 途中で切れた最後のコマは数えない
+      bool scan() {
+          RecordFrame frame;
+          frames = 0;
+          duration = 0;
+          remaining = UINT32_MAX;
+          if (!rewind()) return false;
+          while (decode(frame)) {
+            frames++;
+            duration = frame.time / 1000.0f;
+          }
+          remaining = frames;
+          return rewind();
+      }
+    public:
+      /// @brief 記録を開き、最初の二コマを読む。
+      /// 先頭のコマ数が０の場合は、記録が途中で止まったものとして最後まで読めたコマを使う
+      /// @param filename ファイル名
+      /// @return 開けたか（SDカードが入ってないか、記録でない場合は false）
+      bool open(const char *filename) {
+          close();
+          if (!Brain.SDcard.isInserted()) return false;
+          file = fopen(filename, "rb");
+          if (file == NULL) return false;
+          if (fread(buffer, 1, RECORD_HEADER, file) != RECORD_HEADER || buffer[0] != RECORD_MAGIC[0] || buffer[1] != RECORD_MAGIC[1]
+              || buffer[2] != RECORD_MAGIC[2] || buffer[3] != RECORD_MAGIC[3]) {
+            close();
+            return false;
+          }
+          frames = remaining = GetWord(buffer + 4);
+          duration = GetWord(buffer + 8) / 1000.0f;
+          if (!(frames > 0 ? rewind() : scan())) {
+            close();
+            return false;
+          }
+          opened = decode(previous);
+          next = previous;
+          if (opened) decode(next);
+          if (!opened) close();
+          return opened;
+      }
+      /// @brief 記録を閉じる
+      void close() {
+          if (file != NULL) fclose(file);
+          file = NULL;
+          opened = false;
+      }
+      /// @brief ある時刻の参照状態を求める（時刻は戻らないものとして、必要なだけ記録を読み進める）
+      /// @param t 記録を始めてからの時間（秒）
+      /// @param state 参照状態の代入先（速度と角速度は前後のコマの差から求める。加速度と曲率は０）
+      /// @return 記録の中の時刻か（終わりを過ぎたら false）
+      bool sample(float t, TrajectoryState &state) {
+          if (!opened) return false;
+          uint32_t time = t * 1000;
+          while (next.time <= time) {
+            RecordFrame frame;
+            if (!decode(frame)) return false;
+            dist += hypot(next.pose.x - previous.pose.x, next.pose.y - previous.pose.y);
+            previous = next;
+            next = frame;
+          }
+          float span = fmax((next.time - previous.time) / 1000.0f, SMALL);
+          float u = fitToRange((t - previous.time / 1000.0f) / span, 0, 1);
+          float dx = next.pose.x - previous.pose.x, dy = next.pose.y - previous.pose.y;
+          float turn = wrap(previous.pose.w, next.pose.w);
+          Vector forward {previous.pose.w + turn * u + 90};
+          state.t = t;
+          state.dist = dist + hypot(dx, dy) * u;
+          state.x = previous.pose.x + dx * u;
+          state.y = previous.pose.y + dy * u;
+          state.heading = bound(previous.pose.w + turn * u);
+          state.vx = dx / span;
+          state.vy = dy / span;
+          state.v = state.vx * forward.x + state.vy * forward.y; // 前方向の速さ（後退は負）
+          state.a = 0;
+          state.curvature = 0;
+          state.omega = turn / span;
+          return true;
+      }
+  };
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef RELOCALIZATION
+#define RELOCALIZATION
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/Pose.h"
+  #include "lib/WallModel.h"
+
+  const float MM_TO_INCH = 1 / 25.4; //　掛けてミリをインチに
+
+  #ifdef VexV5
+
+    /// @brief V5 の距離センサを使い、壁との照合で自己位置推定を修正するクラス。
+    /// update を制御ループで毎回呼ぶと小さな割合で連続的に修正し、relocalize を止まっている時に呼ぶと一度に修正する
+    /// @tparam N 距離センサの最大数
+    template <int N = 4>
+    class DistanceRelocalizer : public WallRelocalizer<N> {
+      private:
+        vex::distance *sensors[N]; //　距離センサ
+      public:
+        float gain = 0.2;          //　update の修正の割合（０から１）
+        float recoveryGate = 12;   //　relocalize の外れ値の閾値（大きくずれていても修正できるよう広い・インチ）
+      private:
+        /// @brief 全ての距離センサを読む
+        /// @param readings 距離の代入先（インチ・物が見えなければ ー１）
+        void read(float *readings) {
+            for (int i = 0; i < this -> count; i++) {
+              bool seen = sensors[i] -> installed() && sensors[i] -> isObjectDetected();
+              readings[i] = seen ? sensors[i] -> objectDistance(vex::distanceUnits::mm) * MM_TO_INCH : -1;
+            }
+        }
+        /// @brief 照合して自己位置を修正する
+        template <class D>
+        bool apply(D &drive, float gate, float gain) {
+            float readings[N];
+            read(readings);
+            if (!this -> solve(drive.pose, readings, gate)) return false;
+            Vector measured {drive.pose.x + this -> correction.x, drive.pose.y + this -> correction.y};
+            drive.correct(measured, vex::timer::system(), gain);
+            return true;
+        }
+      public:
+        /// @brief 距離センサを登録
+        /// @param sensor 距離センサ
+        /// @param x 回転中心から右への距離（インチ）
+        /// @param y 回転中心から前への距離（インチ）
+        /// @param angle 向き（度数・０が前、反時計回りが正）
+        /// @return センサの番号（登録できない場合 ー１）
+        int add(vex::distance &sensor, float x, float y, float angle) {
+            int i = this -> addMount(x, y, angle);
+            if (i >= 0) sensors[i] = &sensor;
+            return i;
+        }
+        /// @brief 外れ値を捨てながら少しずつ修正する（localize の後に制御ループで毎回呼ぶ）
+        /// @param drive 車台（DifferentialDrive か HolonomicDrive）
+        /// @return 修正したか
+        template <class D>
+        bool update(D &drive) {
+            return apply(drive, this -> gate, gain);
+        }
+        /// @brief 広い閾値で一度に修正する（壁の近くで止まっている時に呼ぶ。setPose による手動のリセットの代わり）
+        /// @param drive 車台（DifferentialDrive か HolonomicDrive）
+        /// @return 修正したか
+        template <class D>
+        bool relocalize(D &drive) {
+            drive.localize();
+            return apply(drive, recoveryGate, 1);
+        }
+    };
+
+  #endif
+
+#endif
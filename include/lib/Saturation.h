@@ -0,0 +1,57 @@
+#ifndef SATURATION
+#define SATURATION
+
+  #include "lib/Include.h"
+
+  /// @brief 車輪の出力が１を超えた時、何を優先して出力を減らすかを選択できる列挙型
+  /// @param proportional 全ての車輪を同じ比率で減らす（進行方向は保つが速度も回転も遅くなる）
+  /// @param keepPath 平面的横断を保ち、余った分だけ回転に使う（経路から外れない）
+  /// @param keepHeading 回転を保ち、余った分だけ平面的横断に使う（角度を外さない）
+  enum SaturationPriority { proportional, keepPath, keepHeading };
+
+  /// @brief 成分 a を保ったまま、全ての車輪が（-1から1）に入る成分 b の最大の比率を求める
+  /// @param a 保つ成分の各車輪の出力
+  /// @param b 減らす成分の各車輪の出力
+  /// @param count 車輪の数
+  /// @return 成分 b に掛ける比率（0から1）
+  float headroom(const float *a, const float *b, int count) {
+    float k = 1;
+    for (int i = 0; i < count; i++) {
+      if (fabs(b[i]) < SMALL) continue;
+      // |a + k * b| <= 1 を満たす最大の k
+      k = fmin(k, (1 - copysignf(1, b[i]) * a[i]) / fabs(b[i]));
+    }
+    return fmax(k, 0);
+  }
+
+  /// @brief 平面的横断と回転の成分から車輪の出力を求め、優先順位に従い（-1から1）に収める
+  /// @param translation 平面的横断による各車輪の出力（書き換えられる）
+  /// @param rotation 回転による各車輪の出力（書き換えられる）
+  /// @param output 各車輪の最終的な出力
+  /// @param count 車輪の数
+  /// @param priority 優先順位
+  /// @return 出力を減らしたか（飽和したか）
+  bool desaturate(float *translation, float *rotation, float *output, int count, SaturationPriority priority) {
+    float max = 0;
+    for (int i = 0; i < count; i++) max = fmax(max, fabs(translation[i] + rotation[i]));
+    if (max <= 1) { // 飽和していなければそのまま
+      for (int i = 0; i < count; i++) output[i] = translation[i] + rotation[i];
+      return false;
+    }
+    if (priority == proportional) { // 一番でかい値で割る（１以下になる）
+      for (int i = 0; i < count; i++) output[i] = (translation[i] + rotation[i]) / max;
+      return true;
+    }
+    float *kept = priority == keepPath ? translation : rotation;   // 保つ成分
+    float *reduced = priority == keepPath ? rotation : translation; // 減らす成分
+    // 保つ成分だけでも１を超える場合はその成分を比例的に減らす
+    float keptMax = 0;
+    for (int i = 0; i < count; i++) keptMax = fmax(keptMax, fabs(kept[i]));
+    if (keptMax > 1) for (int i = 0; i < count; i++) kept[i] /= keptMax;
+    // 余った分だけもう片方の成分を使う
+    float k = headroom(kept, reduced, count);
+    for (int i = 0; i < count; i++) output[i] = kept[i] + k * reduced[i];
+    return true;
+  }
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef SCHEDULER
+#define SCHEDULER
+
+  #include "lib/Include.h"
+  #include <stdint.h>
+
+  /// @brief 周期的に呼ばれる制御関数
+  typedef void (*PeriodicCallback)();
+
+  /// @brief 周期超過や締め切り遅れを知らせる関数
+  /// @param id タスクの番号（add の戻り値）
+  /// @param amount 超過の場合は実行時間（マイクロ秒）、遅れの場合は飛ばした周期の数
+  typedef void (*PeriodicHook)(int id, uint32_t amount);
+
+  /// @brief 周期実行器に登録されたタスク
+  /// @param callback 呼ぶ関数
+  /// @param period 周期（ミリ秒）
+  /// @param priority 優先度（大きいほど先に実行）
+  /// @param id タスクの番号
+  /// @param next 次に実行すべき時刻（マイクロ秒）
+  /// @param runs 実行した回数
+  /// @param overruns 実行時間が周期を超えた回数
+  /// @param misses 締め切りに間に合わず飛ばした周期の数
+  /// @param worst 最長の実行時間（マイクロ秒）
+  /// @param jitter 最大の開始の遅れ（マイクロ秒）
+  struct PeriodicTask {
+    PeriodicCallback callback;
+    uint32_t period;
+    int priority;
+    int id;
+    uint64_t next;
+    uint32_t runs;
+    uint32_t overruns;
+    uint32_t misses;
+    uint32_t worst;
+    uint32_t jitter;
+  };
+
+  /// @brief 登録された制御関数を絶対時刻の周期の境目で実行するクラス。
+  /// 次の実行時刻は前回の予定時刻に周期を足して求めるので、関数の実行時間が変わっても周期はずれない。
+  /// 同じ時刻に実行すべきタスクは優先度の高い順に実行し、周期を丸ごと逃した場合は追いつこうとせず次の境目に合わせる。
+  /// @tparam N タスクの最大数
+  template <int N = 8>
+  class PeriodicExecutor {
+    private:
+      PeriodicTask tasks[N]; //　優先度の順に並んだタスク
+      int count = 0;         //　タスクの数
+      bool running = false;  //　run の実行中か
+    public:
+      PeriodicHook onOverrun = NULL; //　実行時間が周期を超えた時に呼ばれる
+      PeriodicHook onMiss = NULL;    //　締め切りに間に合わなかった時に呼ばれる
+    public:
+      /// @brief タスクを登録する
+      /// @param callback 呼ぶ関数
+      /// @param period 周期（ミリ秒）
+      /// @param priority 優先度（大きいほど先に実行）
+      /// @return タスクの番号（登録できない場合 ー１）
+      int add(PeriodicCallback callback, uint32_t period, int priority = 0) {
+          if (count >= N || callback == NULL || period == 0) return -1;
+          // 優先度の順を保つよう挿入（同じ優先度は登録順）
+          int i = count;
+          while (i > 0 && tasks[i - 1].priority < priority) {
+            tasks[i] = tasks[i - 1];
+            i--;
+          }
+          tasks[i] = PeriodicTask {callback, period, priority, count, 0, 0, 0, 0, 0, 0};
+          return count++;
+      }
+      /// @brief タスクを全て消す
+      void clear() {
+          count = 0;
+          running = false;
+      }
+      /// @brief 番号のタスクの統計
+      /// @param id タスクの番号
+      /// @param stats 統計の代入先
+      /// @return タスクがあったか（なければ stats は変えない）
+      bool task(int id, PeriodicTask &stats) const {
+          for (int i = 0; i < count; i++) {
+            if (tasks[i].id != id) continue;
+            stats = tasks[i];
+            return true;
+          }
+          return false;
+      }
+      /// @brief タスクの数
+      int size() const {
+          return count;
+      }
+      /// @brief 全てのタスクの周期を現在の時刻から始める
+      void start() {
+          uint64_t now = vex::timer::systemHighResolution();
+          for (int i = 0; i < count; i++) {
+            tasks[i].next = now;
+            tasks[i].runs = tasks[i].overruns = tasks[i].misses = 0;
+            tasks[i].worst = tasks[i].jitter = 0;
+          }
+      }
+      /// @brief 実行時刻になったタスクを優先度の順に一度ずつ実行する
+      /// @return 次にいずれかのタスクを実行すべき時刻（マイクロ秒）
+      uint64_t step() {
+          uint64_t earliest = UINT64_MAX;
+          for (int i = 0; i < count; i++) {
+            PeriodicTask &task = tasks[i];
+            uint64_t period = (uint64_t) task.period * 1000;
+            uint64_t now = vex::timer::systemHighResolution();
+            if (now >= task.next) {
+              uint32_t late = now - task.next;
+              if (late > task.jitter) task.jitter = late;
+              task.callback();
+              task.runs++;
+              uint64_t end = vex::timer::systemHighResolution();
+              uint32_t duration = end - now;
+              if (duration > task.worst) task.worst = duration;
+              if (duration > period) {
+                task.overruns++;
+                if (onOverrun != NULL) onOverrun(task.id, duration);
+              }
+              // 次の境目へ進める。既に過ぎた境目は飛ばして遅れとして数える
+              task.next += period;
+              if (end >= task.next) {
+                uint32_t skipped = (end - task.next) / period + 1;
+                task.next += skipped * period;
+                task.misses += skipped;
+                if (onMiss != NULL) onMiss(task.id, skipped);
+              }
+            }
+            if (task.next < earliest) earliest = task.next;
+          }
+          return earliest;
+      }
+      /// @brief stop が呼ばれるまでタスクを実行し続ける（タスクの中から stop を呼んで終える）
+      void run() {
+          if (count == 0) return;
+          start();
+          running = true;
+          while (running) {
+            uint64_t next = step();
+            if (!running) break;
+            uint64_t now = vex::timer::systemHighResolution();
+            // 次の境目まで他のスレッドに処理を譲る（ミリ秒単位で切り上げ、１ミリ秒未満でも空回りしない）
+            if (next > now) wait((next - now + 999) / 1000, msec);
+          }
+      }
+      /// @brief run を終える
+      void stop() {
+          running = false;
+      }
+  };
+
+#endif
@@ -0,0 +1,257 @@
+#ifndef TIMED_TRAJECTORY
+#define TIMED_TRAJECTORY
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/Pose.h"
+  #include "lib/Trajectory.h"
+  #include "lib/FixedVector.h"
+
+  /// @brief ある時刻にロボットがあるべき状態（参照状態）
+  /// @param t 経路開始からの時間（秒）
+  /// @param dist 経路の始点からの距離（インチ）
+  /// @param x 位置の x 値（インチ）
+  /// @param y 位置の y 値（インチ）
+  /// @param heading ロボットの角度（度数）
+  /// @param vx 速度の x 値（インチ毎秒）
+  /// @param vy 速度の y 値（インチ毎秒）
+  /// @param v 進行方向の速さ（インチ毎秒・非ホロノミック系の逆走では負）
+  /// @param a 進行方向の加速度（インチ毎秒毎秒）
+  /// @param curvature 経路の曲率（1/インチ・左曲がりが正）
+  /// @param omega ロボットの角速度（度毎秒・反時計回りが正）
+  struct TrajectoryState {
+    float t;
+    float dist;
+    float x;
+    float y;
+    float heading;
+    float vx;
+    float vy;
+    float v;
+    float a;
+    float curvature;
+    float omega;
+  };
+
+  /// @brief ホロノミック系の経由地の進行方向（角度）。速度ベクトルの向きは経由地での経路の接線の向き
+  /// @param trajectory 軌道
+  /// @param i 経由地の番号
+  template <int N>
+  float TravelAngle(const BasicHolonomicTrajectory<N> &trajectory, int i) {
+    const Pose &heading = trajectory.waypoints[i].heading;
+    return Vector {heading.x, heading.y}.getAngle();
+  }
+
+  /// @brief 非ホロノミック系の経由地の進行方向（角度）。ロボットの角度に90度を足し、逆走の場合は180度を引く
+  /// @param trajectory 軌道
+  /// @param i 経由地の番号
+  template <int N>
+  float TravelAngle(const BasicDifferentialTrajectory<N> &trajectory, int i) {
+    const Waypoint &waypoint = trajectory.waypoints[i];
+    float angle = trajectory.type == spline ? waypoint.heading.w : trajectory.initialPose.w; // 直線補間は初期角度のまま
+    return bound(angle + 90 + (waypoint.heading.y < 0 ? 180 : 0));
+  }
+
+  /// @brief 経由地 i - 1 から経由地 i への弦の向き。経由地の進行方向は経路の接線なので、
+  /// 両端の接線の中間の角度で進むと経由地の位置が二次の精度で復元できる
+  /// @param previous 経由地 i - 1 の進行方向（角度）
+  /// @param angle 経由地 i の進行方向（角度）
+  float ChordAngle(float previous, float angle) {
+    return bound(previous + wrap(previous, angle) / 2);
+  }
+
+  /// @brief ホロノミック系の経由地でロボットがあるべき角度（ホロノミック姿勢がなければ初期角度）
+  template <int N>
+  float RobotAngle(const BasicHolonomicTrajectory<N> &trajectory, int i) {
+    return trajectory.orientation ? trajectory.waypoints[i].heading.w : trajectory.initialPose.w;
+  }
+
+  /// @brief 非ホロノミック系の経由地でロボットがあるべき角度
+  template <int N>
+  float RobotAngle(const BasicDifferentialTrajectory<N> &trajectory, int i) {
+    return trajectory.type == spline ? trajectory.waypoints[i].heading.w : trajectory.initialPose.w;
+  }
+
+  /// @brief 時間で媒介変数表示された軌道クラス。距離で並ぶ経由地から位置、速度、加速度、曲率、角速度を求め、
+  /// 等しい時間間隔の参照状態に並べ直して保存する。時刻による参照は番号の計算と線形補間だけで O(1)。
+  /// @tparam N 参照状態の数
+  template <int N = TRAJECTORY_CAPACITY>
+  class TimedTrajectory {
+    static_assert(N >= 2, "a timed trajectory needs at least two states");
+    public:
+      FixedVector<TrajectoryState, N> states; //　等しい時間間隔の参照状態
+      Pose initialPose {0,0,0}; //　初期姿勢
+      Pose finalPose {0,0,0};   //　最終姿勢
+      float duration = 0; //　計画された所要時間（秒）
+      float length = 0;   //　経路の長さ（インチ）
+      float interval = 0; //　参照状態の時間間隔（秒）
+      bool orientation;   //　参照状態の角度を追従すべきか（ホロノミック姿勢かスプライン補間）
+      bool relative = false; //　直線補間の軌道か（相対的な動きなので、実行を始めた時の姿勢を始点とする）
+      bool holonomic = false; //　ホロノミック系の軌道から作ったか
+      MarkerList<> markers; //　経路上の目印（元の軌道から引き継ぐ）
+    private:
+      Vector origin {0, 0}; //　直線補間の軌道の始点（anchor で実行を始めた時の位置にする）
+      float offset = 0;     //　参照状態に足す角度（非ホロノミック系の直線補間は開始時のロボットの角度に合わせる）
+    private:
+      /// @brief 二つの参照状態を線形補間
+      static TrajectoryState lerp(const TrajectoryState &a, const TrajectoryState &b, float u) {
+          TrajectoryState s;
+          s.t = a.t + (b.t - a.t) * u;
+          s.dist = a.dist + (b.dist - a.dist) * u;
+          s.x = a.x + (b.x - a.x) * u;
+          s.y = a.y + (b.y - a.y) * u;
+          s.heading = bound(a.heading - wrap(b.heading, a.heading) * u); //　最短角度差で補間
+          s.vx = a.vx + (b.vx - a.vx) * u;
+          s.vy = a.vy + (b.vy - a.vy) * u;
+          s.v = a.v + (b.v - a.v) * u;
+          s.a = a.a + (b.a - a.a) * u;
+          s.curvature = a.curvature + (b.curvature - a.curvature) * u;
+          s.omega = a.omega + (b.omega - a.omega) * u;
+          return s;
+      }
+      /// @brief ある姿勢で止まっている参照状態
+      static TrajectoryState rest(const Pose &pose) {
+          return TrajectoryState {0, 0, pose.x, pose.y, pose.w, 0, 0, 0, 0, 0, 0};
+      }
+      /// @brief 始点の参照状態（速度は最初の経由地と同じ）
+      /// @param trajectory 元の軌道（経由地が一つ以上あるもの）
+      /// @param maxSpeed 速度出力１の時のロボットの速度（インチ毎秒）
+      template <class T>
+      static TrajectoryState begin(const T &trajectory, float maxSpeed) {
+          const Waypoint &waypoint = trajectory.waypoints[0];
+          float angle = TravelAngle(trajectory, 0);
+          float speed = Vector {waypoint.heading.x, waypoint.heading.y}.getMagnitude() * maxSpeed;
+          float sign = waypoint.heading.y < 0 && !T::holonomic ? -1 : 1; // 非ホロノミック系の逆走
+          TrajectoryState start = rest(Pose {trajectory.initialPose.x, trajectory.initialPose.y, RobotAngle(trajectory, 0)});
+          start.v = sign * speed;
+          start.vx = speed * cosf(angle / RadToDeg);
+          start.vy = speed * sinf(angle / RadToDeg);
+          return start;
+      }
+      /// @brief 前の参照状態から経由地 i の参照状態を求める
+      /// @param trajectory 元の軌道
+      /// @param i 経由地の番号
+      /// @param maxSpeed 速度出力１の時のロボットの速度（インチ毎秒）
+      /// @param last 経由地 i - 1 の参照状態（i が０の場合は始点）
+      /// @return 経由地 i の参照状態
+      template <class T>
+      static TrajectoryState advance(const T &trajectory, int i, float maxSpeed, const TrajectoryState &last) {
+          const Waypoint &waypoint = trajectory.waypoints[i];
+          float previousAngle = TravelAngle(trajectory, i > 0 ? i - 1 : 0);
+          float angle = TravelAngle(trajectory, i);
+          float speed = Vector {waypoint.heading.x, waypoint.heading.y}.getMagnitude() * maxSpeed;
+          float sign = waypoint.heading.y < 0 && !T::holonomic ? -1 : 1; // 非ホロノミック系の逆走
+          float ds = fmax(waypoint.dist - last.dist, 0);
+          TrajectoryState state;
+          // 経由地間の弦の向きに進んで位置を求める
+          float chord = ChordAngle(previousAngle, angle);
+          state.x = last.x + ds * cosf(chord / RadToDeg);
+          state.y = last.y + ds * sinf(chord / RadToDeg);
+          state.dist = waypoint.dist;
+          state.heading = RobotAngle(trajectory, i);
+          state.v = sign * speed;
+          state.vx = speed * cosf(angle / RadToDeg);
+          state.vy = speed * sinf(angle / RadToDeg);
+          // 平均速度で区間の所要時間を求める
+          float average = (fabs(last.v) + speed) / 2;
+          float dt = ds / fmax(average, SMALL);
+          state.t = last.t + dt;
+          state.a = ds > SMALL ? (speed * speed - last.v * last.v) / (2 * ds) : 0;
+          state.curvature = ds > SMALL ? -wrap(angle, previousAngle) / RadToDeg / ds : 0;
+          state.omega = dt > SMALL ? -wrap(state.heading, last.heading) / dt : 0;
+          return state;
+      }
+      /// @brief 距離で並ぶ経由地から参照状態を求め、等しい時間間隔に並べ直す。
+      /// 経由地の参照状態は走査しながら求め、前後の二つだけを持つので、スタックの使用量は経由地の数によらない
+      /// @param trajectory 元の軌道
+      /// @param maxSpeed 速度出力１の時のロボットの速度（インチ毎秒）
+      template <class T>
+      void build(const T &trajectory, float maxSpeed) {
+          int n = trajectory.waypoints.size();
+          initialPose = trajectory.initialPose;
+          length = trajectory.length;
+          markers = trajectory.markers;
+          states.clear();
+          if (n == 0) { // 経由地のない軌道は始点で止まっている一つの状態
+            states.push_back(rest(initialPose));
+            duration = 0;
+            interval = 0;
+            finalPose = initialPose;
+            return;
+          }
+          // 一度目の走査で所要時間と終点を求める
+          TrajectoryState last = begin(trajectory, maxSpeed);
+          for (int i = 0; i < n; i++) last = advance(trajectory, i, maxSpeed, last);
+          duration = last.t;
+          interval = duration / (N - 1);
+          finalPose = Pose {last.x, last.y, last.heading};
+          // 二度目の走査で等しい時間間隔に並べ直す（a と b は経由地 j - 1 と j の参照状態）
+          TrajectoryState a = begin(trajectory, maxSpeed);
+          TrajectoryState b = advance(trajectory, 0, maxSpeed, a);
+          int j = 0;
+          for (int k = 0; k < N; k++) {
+            float t = k * interval;
+            while (j < n - 1 && b.t < t) {
+              a = b;
+              b = advance(trajectory, ++j, maxSpeed, a);
+            }
+            float span = b.t - a.t;
+            float u = span > SMALL ? fitToRange((t - a.t) / span, 0, 1) : 1;
+            states.push_back(lerp(a, b, u));
+          }
+      }
+    public:
+      /// @brief ホロノミック系の軌道から時間で媒介変数表示された軌道を作成
+      /// @param trajectory 元の軌道
+      /// @param maxSpeed 速度出力１の時のロボットの速度（インチ毎秒）
+      template <int M>
+      TimedTrajectory(const BasicHolonomicTrajectory<M> &trajectory, float maxSpeed) {
+          build(trajectory, maxSpeed);
+          orientation = trajectory.orientation;
+          relative = trajectory.type == linear;
+          holonomic = true;
+      }
+      /// @brief 非ホロノミック系の軌道から時間で媒介変数表示された軌道を作成
+      /// @param trajectory 元の軌道
+      /// @param maxSpeed 速度出力１の時のロボットの速度（インチ毎秒）
+      template <int M>
+      TimedTrajectory(const BasicDifferentialTrajectory<M> &trajectory, float maxSpeed) {
+          build(trajectory, maxSpeed);
+          orientation = trajectory.type == spline;
+          relative = trajectory.type == linear;
+      }
+      /// @brief 実行を始める時に呼び、直線補間の軌道の始点をロボットの姿勢に合わせる（スプライン補間の軌道は場の座標なので何もしない）。
+      /// ホロノミック系は平行移動だけ、非ホロノミック系はロボットの角度の向きに回転もする（PathProgress と同じ）
+      /// @param pose 実行を始めた時のロボットの姿勢
+      void anchor(const Pose &pose) {
+          if (!relative) return;
+          origin = Vector {pose.x, pose.y};
+          offset = holonomic ? 0 : pose.w - initialPose.w;
+      }
+      /// @brief ある時刻の参照状態を返す（O(1)）
+      /// @param t 経路開始からの時間（秒）
+      /// @return 補間された参照状態（直線補間の軌道は anchor で合わせた始点からの状態）
+      TrajectoryState sample(float t) const {
+          TrajectoryState state;
+          float position = t / fmax(interval, SMALL);
+          int i = (int) position;
+          if (states.size() == 0) state = rest(initialPose);
+          else if (t <= 0) state = states.front();
+          else if (t >= duration || i >= states.size() - 1) state = states.back();
+          else state = lerp(states[i], states[i + 1], position - i);
+          if (!relative) return state;
+          // 始点からの変位を回転して、実行を始めた時の位置に足す
+          Vector rotation {offset};
+          float dx = state.x - initialPose.x, dy = state.y - initialPose.y;
+          state.x = origin.x + rotation.x * dx - rotation.y * dy;
+          state.y = origin.y + rotation.y * dx + rotation.x * dy;
+          float vx = state.vx;
+          state.vx = rotation.x * vx - rotation.y * state.vy;
+          state.vy = rotation.y * vx + rotation.x * state.vy;
+          state.heading = bound(state.heading + offset);
+          return state;
+      }
+  };
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef TRACKING_STATS
+#define TRACKING_STATS
+
+  #include "lib/Include.h"
+  #include "lib/Vector.h"
+  #include <stdint.h>
+
+  /// @brief 一種類の追従誤差の統計
+  /// @param sum 誤差の二乗の合計
+  /// @param count 標本の数
+  /// @param max 最大の誤差の絶対値
+  /// @param where 最大の誤差が出た時の実行の捗り（0から1）
+  struct ErrorStatistic {
+    float sum;
+    int count;
+    float max;
+    float where;
+    /// @brief 統計を消す
+    void reset() {
+        sum = 0;
+        count = 0;
+        max = 0;
+        where = 0;
+    }
+    /// @brief 誤差を一つ加える
+    /// @param error 誤差
+    /// @param progress 実行の捗り（0から1）
+    void add(float error, float progress) {
+        sum += error * error;
+        count++;
+        if (fabs(error) > max) {
+          max = fabs(error);
+          where = progress;
+        }
+    }
+    /// @brief 二乗平均平方根
+    float rms() const {
+        return count > 0 ? sqrt(sum / count) : 0;
+    }
+  };
+
+  /// @brief 参照位置に対する進行方向と横方向の誤差
+  /// @param dx 現在の x 値から参照位置の x 値を引いたもの
+  /// @param dy 現在の y 値から参照位置の y 値を引いたもの
+  /// @param angle 進行方向（角度）
+  /// @return x が進行方向の誤差（正は先行）、y が横方向の誤差（正は進行方向の左）
+  Vector TrackError(float dx, float dy, float angle) {
+    Vector travel {angle};
+    return Vector {dx * travel.x + dy * travel.y, travel.x * dy - travel.y * dx};
+  }
+
+  /// @brief 一回の軌道の実行の追従誤差と所要時間を記録するクラス。
+  /// 実行が終わった後も次の実行が始まるまで値を保つので、調整の前後やライブラリの版を比べられる
+  class TrackingStats {
+    private:
+      uint32_t startTime = 0; //　実行を始めた時間（ミリ秒）
+      uint32_t lastTime = 0;  //　前回記録した時間（ミリ秒）
+    public:
+      ErrorStatistic crossTrack {0, 0, 0, 0}; //　横方向の誤差（インチ）
+      ErrorStatistic alongTrack {0, 0, 0, 0}; //　進行方向の誤差（インチ・正は計画より先行）
+      ErrorStatistic heading {0, 0, 0, 0};    //　角度の誤差（度）
+      float initialHeading = 0; //　実行を始めた時のロボットの角度（角度を制御しない軌道の目標）
+      float planned = 0;        //　計画された所要時間（秒）
+      float actual = 0;         //　実際の所要時間（秒）
+      float saturatedTime = 0;  //　車輪が飽和していた時間（秒）
+      bool running = false;     //　実行中か
+    public:
+      /// @brief 実行を始め、前回の統計を消す
+      /// @param planned 計画された所要時間（秒）
+      /// @param heading ロボットの角度（度数）
+      void begin(float planned, float heading) {
+          crossTrack.reset();
+          alongTrack.reset();
+          this -> heading.reset();
+          initialHeading = heading;
+          this -> planned = planned;
+          actual = 0;
+          saturatedTime = 0;
+          startTime = lastTime = vex::timer::system();
+          running = true;
+      }
+      /// @brief 実行を始めてからの時間
+      /// @return 秒
+      float elapsed() const {
+          return (vex::timer::system() - startTime) / 1000.0f;
+      }
+      /// @brief 一周期の誤差を記録する
+      /// @param cross 横方向の誤差（インチ）
+      /// @param along 進行方向の誤差（インチ）
+      /// @param angle 角度の誤差（度）
+      /// @param progress 実行の捗り（0から1）
+      /// @param saturated 車輪が飽和したか
+      void add(float cross, float along, float angle, float progress, bool saturated) {
+          uint32_t now = vex::timer::system();
+          if (saturated) saturatedTime += (now - lastTime) / 1000.0f;
+          lastTime = now;
+          actual = (now - startTime) / 1000.0f;
+          crossTrack.add(cross, progress);
+          alongTrack.add(along, progress);
+          heading.add(angle, progress);
+      }
+      /// @brief 実行を終える
+      void end() {
+          actual = elapsed();
+          running = false;
+      }
+      /// @brief 実際の所要時間と計画された所要時間の比（１より大きいほど遅い）
+      float slowdown() const {
+          return planned > SMALL ? actual / planned : 0;
+      }
+  };
+
+#endif
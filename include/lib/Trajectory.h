@@ -6,6 +6,12 @@
   #include "lib/Vector.h"
   #include "lib/Pose.h"
   #include "lib/VelocityProfile.h"
+  #include "lib/FixedVector.h"
+  #include "lib/HeadingProfile.h"
+  #include "lib/Markers.h"
+
+  const int TRAJECTORY_CAPACITY = 100; //　軌道の既定の経由地数
+  const int PROFILE_SAMPLES = 100;     //　速度プロフィールの既定の定義域（StaticProfile の distance の既定値）
 
   /// @brief　補間方法を選択できる列挙型
   /// @param linear 直線補間
@@ -50,21 +56,12 @@
     Pose heading;
   };
 
-  /// @brief 目的のホロノミック姿勢を経路の特定の処理位置に登録（ホロノミック姿勢はホロノミック車台の角度を示します。
-  /// ホロノミック系のロボットは平面的横断と回転を同時に行う機能を持ち、進行方向と別の角度を保つことができる）。
-  /// @param dist 特定する処理位置 (0 から 1)
-  /// @param angle　ロボットの角度
-  struct HolonomicPose {
-    float dist;
-    float angle;
-  };
-
   /// @brief エルミート補間式にある処理位置（x）を問い、そ地点の姿勢を返す
   /// @param path エルミート補間式の定義
   /// @param previous 前回の処理位置の姿勢
   /// @param x 処理位置（0から１）
   /// @return 処理位置（x）のロボット姿勢
-  Pose CubicHermiteInterpolation(Path path, Pose previous, float x) {
+  Pose CubicHermiteInterpolation(const Path &path, const Pose &previous, float x) {
     // エルミート補間多項式の表現
     float h1 = 2*(x*x*x) - 3*(x*x) + 1; //　１から始まり０に向かって低下する
     float h2 = -2*(x*x*x) + 3*(x*x);    //　０から始まり１に向かって上昇する
@@ -80,48 +77,163 @@
     return current; //　姿勢を返す
   }
 
-  /// @brief ホロノミック姿勢の std::vector をある処理位置　x で補間。
-  /// 目的姿勢を提示された経路位置に厳密に達成する為に滑らか且つ徐々に近づいていく必要がありました。
-  /// この関数は提示された処理位置を用いて全ての処理位置のあるべき姿勢を導く役割を果たしています。
-  /// @param orientation ホロノミック姿勢の　std::vector （処理位置０と１の姿勢は必ず定義されている）
-  /// @param x 処理位置
-  /// @return 補間値
-  float InterpolateHolonomicPose(std::vector<HolonomicPose> orientation, float x ) {
-    if ( ! orientation.empty() ) { //　ホロノミック姿勢が示されているか
-      int s = 0; //　イテレータ初期化
-      //　std::vector から現在の処理位置（x）が入る区間を探る
-      //　区間の先頭と後尾の角度と処理位置の差を取ることで直線補間を行うことができる
-      while (orientation.at(s).dist < x) { s++; if (s == orientation.size() - 1) break; } //　std::vector を探
-      float angleError = wrap(orientation.at(s-1).angle, orientation.at(s).angle);        //　区間の最短角度差を求める
-      float distError = orientation.at(s).dist - orientation.at(s-1).dist;                //　区間の処理位置の差を求める
-      x -= orientation.at(s-1).dist;                                                      //  
-      return bound( (x / distError) * angleError + orientation.at(s-1).angle );           //  直線補間を行う
-    } else {
-      return -1; //　ホロノミック姿勢が示されてない場合（ー１）を返す
+  /// @brief エルミート補間式を冪基底の係数 P(x) = a + b x + c x^2 + d x^3 に一度だけ直し、
+  /// 等間隔の処理位置を前進差分で順に求めるクラス。一つの処理位置は x と y で独立した数回の加算だけで求まる。
+  /// 角度は前回の位置との差ではなく導関数 P'(x) から求めるので、処理位置での接線の角度そのものとなる。
+  /// 差分の誤差が積もらないよう内部は倍精度で持つ
+  class HermiteEvaluator {
+    private:
+      double position[2][4]; //　位置と一次から三次の前進差分（x と y）
+      double tangent[2][3];  //　一次導関数と一次、二次の前進差分
+      double bend[2][2];     //　二次導関数と一次の前進差分
+    public:
+      float x = 0;         //　位置の x 値
+      float y = 0;         //　位置の y 値
+      float heading = 0;   //　接線の角度（度数・０は右向き）
+      float curvature = 0; //　曲率（1/インチ・反時計回りが正）
+      int index = 0;       //　処理位置の番号（０から clarity まで）
+    private:
+      /// @brief 倍精度の状態から位置、角度、曲率を求める
+      void update() {
+          x = position[0][0];
+          y = position[1][0];
+          double dx = tangent[0][0], dy = tangent[1][0];
+          double norm = sqrt(dx * dx + dy * dy);
+          if (norm < SMALL) return; //　接線が消える点では前回の角度と曲率を保つ
+          heading = atan2(dy, dx) * RadToDeg;
+          curvature = (dx * bend[1][0] - dy * bend[0][0]) / (norm * norm * norm);
+      }
+    public:
+      /// @brief 補間式を係数に直し、処理位置０の状態を求める
+      /// @param path エルミート補間式の定義
+      /// @param clarity 明瞭度（処理位置の刻みは 1 / clarity）
+      HermiteEvaluator(const Path &path, int clarity) {
+          double h = 1.0 / clarity;
+          const float p0[2] = {path.p0.x, path.p0.y}, p1[2] = {path.p1.x, path.p1.y};
+          const float t0[2] = {path.t0.x, path.t0.y}, t1[2] = {path.t1.x, path.t1.y};
+          for (int k = 0; k < 2; k++) {
+            // エルミート基底関数を展開した冪基底の係数
+            double a = p0[k];
+            double b = t0[k];
+            double c = -3 * p0[k] + 3 * p1[k] - 2 * t0[k] - t1[k];
+            double d = 2 * p0[k] - 2 * p1[k] + t0[k] + t1[k];
+            // x = 0 での値と刻み h の前進差分
+            position[k][0] = a;
+            position[k][1] = b * h + c * h * h + d * h * h * h;
+            position[k][2] = 2 * c * h * h + 6 * d * h * h * h;
+            position[k][3] = 6 * d * h * h * h;
+            tangent[k][0] = b;
+            tangent[k][1] = 2 * c * h + 3 * d * h * h;
+            tangent[k][2] = 6 * d * h * h;
+            bend[k][0] = 2 * c;
+            bend[k][1] = 6 * d * h;
+          }
+          heading = atan2f(path.t0.y, path.t0.x) * RadToDeg;
+          update();
+      }
+      /// @brief 次の処理位置に進む
+      void next() {
+          for (int k = 0; k < 2; k++) {
+            position[k][0] += position[k][1];
+            position[k][1] += position[k][2];
+            position[k][2] += position[k][3];
+            tangent[k][0] += tangent[k][1];
+            tangent[k][1] += tangent[k][2];
+            bend[k][0] += bend[k][1];
+          }
+          index++;
+          update();
+      }
+  };
+
+  /// @brief 経由地の番号を速度プロフィールの定義域に変換（容量が既定の100以外でも同じ形のプロフィールになるよう）
+  /// @param i 経由地の番号（1から）
+  /// @param capacity 軌道の経由地数
+  /// @return 速度プロフィールに問う値
+  float ProfileSample(int i, int capacity) {
+    return (float) i * PROFILE_SAMPLES / capacity;
+  }
+
+  /// @brief エルミート補間式を経由地と同じ明瞭度で走査した長さ（軌道の generate が求める長さと一致）
+  /// @param path エルミート補間式の定義
+  /// @param clarity 明瞭度
+  float HermiteLength(const Path &path, int clarity) {
+    float length = 0;
+    HermiteEvaluator spline {path, clarity};
+    for (int i = 1; i <= clarity; i++) {
+      float x = spline.x, y = spline.y;
+      spline.next();
+      length += hypot(spline.x - x, spline.y - y);
     }
+    return length;
   }
 
-  /// @brief 非ホロノミック系ロボットの経路計画クラス
-  class DifferentialTrajectory {
+  /// @brief 速度プロフィールを経路の長さに合わせる。StaticProfile は経由地の番号で引くので何もしない
+  void PlanProfile(StaticProfile &profile, float length) {}
+
+  /// @brief S字の速度プロフィールを経路の長さに合わせて一度だけ計画する
+  void PlanProfile(SCurveProfile &profile, float length) {
+    profile.plan(length);
+  }
+
+  /// @brief スプライン補間の速度プロフィールを計画する。StaticProfile は長さを使わないので補間式を走査しない
+  void PlanProfile(StaticProfile &profile, const Path *paths, int count, int clarity) {}
+
+  /// @brief スプライン補間の長さを求め、S字の速度プロフィールを計画する
+  /// @param paths 区間のエルミート補間式
+  /// @param count 区間の数
+  /// @param clarity 一つの区間の明瞭度
+  void PlanProfile(SCurveProfile &profile, const Path *paths, int count, int clarity) {
+    float length = 0;
+    for (int i = 0; i < count; i++) length += HermiteLength(paths[i], clarity);
+    profile.plan(length);
+  }
+
+  /// @brief 速度プロフィールに経由地の速度出力を問う。StaticProfile は経由地の番号、SCurveProfile は距離で引く
+  /// @param profile 速度プロフィール
+  /// @param sample 経由地の番号を速度プロフィールの定義域に変換した値（ProfileSample）
+  /// @param dist 経路の始点からの距離（インチ）
+  /// @return 速度出力 (0 から 1)
+  float ProfileSpeed(StaticProfile &profile, float sample, float dist) {
+    return profile.get(sample);
+  }
+
+  /// @brief 速度プロフィールに経由地の速度出力を問う（S字の速度プロフィールは距離で引く）
+  float ProfileSpeed(SCurveProfile &profile, float sample, float dist) {
+    return profile.get(dist);
+  }
+
+  /// @brief 非ホロノミック系ロボットの経路計画クラス。経由地は容量 N の固定長配列に保存され、実行中に動的確保を行わない
+  /// @tparam N 経由地の数（区分的補間の場合は半分ずつ使うので偶数）
+  template <int N = TRAJECTORY_CAPACITY>
+  class BasicDifferentialTrajectory {
+    static_assert(N % 2 == 0, "waypoint capacity must be even");
     public:
-      std::vector<Waypoint> waypoints; //　最終的の軌道を表す　std::vector 
+      FixedVector<Waypoint, N> waypoints; //　最終的の軌道を表す固定長配列
       Pose initialPose {0,0,0}; //　初期姿勢
       Pose finalPose {0,0,0};   //　最終姿勢
       PathType type;     //　補間方法
       float length = 0;  //　補間式の長さ
       int index = 0;     //　イテレータ
       bool reverse;      //　経路を逆走行したいか
+      MarkerList<> markers; //　経路上の目印（経路実行が通過した時に呼ぶ）
+      static const int capacity = N;        //　経由地の容量
+      static const bool holonomic = false;  //　ホロノミック系の軌道か
     public:
       /// @brief 直線補間軌道を生成するコンストラクター
       /// @param trajectory1D 動きたい距離（単位はインチ）(負の値も適用)
-      /// @param profile 速度プロフィール
-      DifferentialTrajectory(float trajectory1D, StaticProfile profile) {;
-          // 100個の経由地を生成しそれぞれの距離と角度を求めます
-          for(int i = 1; i <= 100; i++) { //　100回繰り返される（イテレータは1から）
-            float x = 0.01 * i;  //　0から1の処理位置を演算
+      /// @param profile 速度プロフィール（StaticProfile か SCurveProfile）
+      template <class P>
+      BasicDifferentialTrajectory(float trajectory1D, P profile) {
+          PlanProfile(profile, fabs(trajectory1D)); // 速度プロフィールを距離に合わせる
+          // N個の経由地を生成しそれぞれの距離と角度を求めます
+          for(int i = 1; i <= N; i++) { //　N回繰り返される（イテレータは1から）
+            float x = (float) i / N;  //　0から1の処理位置を演算
             Waypoint waypoint;   //　経由地を作成
             waypoint.dist = x * fabs(trajectory1D); //　処理位置に基づき距離を導く
-            waypoint.heading.y = copysign(profile.get(i), trajectory1D); //　処理位置に基づき走るべき速度を導く
+            waypoint.heading.x = 0; //　非ホロノミック系ロボットは横行できません
+            waypoint.heading.w = 0; //　直線補間は初期角度のまま（使わない）
+            waypoint.heading.y = copysign(ProfileSpeed(profile, ProfileSample(i, N), waypoint.dist), trajectory1D); //　処理位置に基づき走るべき速度を導く
             waypoints.push_back( waypoint ); //　軌道に経由地を追加
           }
           this -> type = linear;                //　補間方法代入
@@ -129,93 +241,104 @@
       }
       /// @brief スプライン補間式を生成するコンストラクター（点Aと点Bのみで表せる経路に使用）
       /// @param path エルミート補間式の定義
-      /// @param profile 速度プロフィール
+      /// @param profile 速度プロフィール（StaticProfile か SCurveProfile）
       /// @param reverse OPTIONAL: 経路を逆走走したいか
-      DifferentialTrajectory(Path path, StaticProfile profile, bool reverse = false) {
+      template <class P>
+      BasicDifferentialTrajectory(const Path &path, P profile, bool reverse = false) {
+          PlanProfile(profile, &path, 1, N); // 速度プロフィールを補間式の長さに合わせる
           //（generate）関数を呼び点Aから点Bの間の補間を行う
-          this -> waypoints = generate(path, reverse, 100, profile); 
+          generate(path, reverse, N, profile); 
           this -> reverse = reverse; //  逆走ブール代入
           this -> type = spline;     //　補間方法代入
       }
       /// @brief 区分的スプライン補間式を生成するコンストラクター（点A、点B、点C、で表す経路に使用）
       /// これ以上の制御性を必する経路は分割すべきだと考えられます
       /// @param path 区分的エルミート補間式の定義
-      /// @param profile 速度プロフィール
+      /// @param profile 速度プロフィール（StaticProfile か SCurveProfile）
       /// @param reverse OPTIONAL: 経路を逆走行したいか
-      DifferentialTrajectory(PathPlus path, StaticProfile profile, bool reverse = false) {
-          //（generate）関数を呼び点Aから点Bの間の補間を行う（明瞭度を100の半分に設定）
-          this -> waypoints = generate( Path {path.p0, path.p1, path.t0, path.t1}, reverse, 50, profile ); 
+      template <class P>
+      BasicDifferentialTrajectory(const PathPlus &path, P profile, bool reverse = false) {
+          Path paths[2] = { Path {path.p0, path.p1, path.t0, path.t1}, Path {path.p1, path.p2, path.t1, path.t2} };
+          PlanProfile(profile, paths, 2, N / 2); // 速度プロフィールを二つの補間式の長さの合計に合わせる
+          //（generate）関数を呼び点Aから点Bの間の補間を行う（明瞭度を容量の半分に設定）
+          generate( paths[0], reverse, N / 2, profile ); 
           Pose tempInitialPose = initialPose; //　この時点で初期姿勢は点A。この姿勢を保存します
           float tempLength = length;          //　この時点で経路の長さは点Aから点Bの補間式の長さ。この長さを保存します
-          //（generate）関数を呼び点Bから点Cの間の補間を行う（明瞭度を100の半分に設定）
-          std::vector<Waypoint> waypoints2 = generate( Path {path.p1, path.p2, path.t1, path.t2}, reverse, 50, profile );
+          //（generate）関数を呼び点Bから点Cの間の補間を同じ配列の後ろに追加する（明瞭度を容量の半分に設定）
+          generate( paths[1], reverse, N / 2, profile );
           this -> initialPose = tempInitialPose; //　事前に保存した点Aの姿勢を真の初期姿勢に代入
           this -> length = tempLength + length;  //　点Aから点Bの長さを点Bから点Cの長さに足し真の長さに代入
-          //　点Aから点Bの軌道を点Bから点Cの軌道と合体
-          this -> waypoints.insert(waypoints.end(), waypoints2.begin(), waypoints2.end()); 
           this -> reverse = reverse; //　逆走ブール代入
           this -> type = spline;     //　補間方法代入
       }
-      /// @brief 軌道を生成する関数
+      /// @brief 軌道を生成し経由地の配列の末尾に追加する関数
       /// @param path エルミート補間式の定義
       /// @param reverse 経路を逆走したいか
-      /// @param clarity 明瞭度を示す（一つの経路は100と定められている）
-      /// @param profile 速度プロフィール
-      /// @return 生成された軌道
-      std::vector<Waypoint> generate(Path path, bool reverse, int clarity, StaticProfile profile) {
-          float segment = 1.0 / clarity; //　処理位置の一つ一つの区間の長さを導く
+      /// @param clarity 明瞭度を示す（一つの経路は N と定められている）
+      /// @param profile 速度プロフィール（計画済み）
+      template <class P>
+      void generate(const Path &path, bool reverse, int clarity, P &profile) {
           float dist = 0; //　経路の長さを初期化
-          // 現在姿勢と前回姿勢を宣言
-          Pose previous {path.p0.x, path.p0.y, path.t0.getAngle()}; //　点Aの姿勢に設定　
-          Pose current {0, 0, 0}; //　初期化
-          //　軌道となる経由地の配列を作成
-          std::vector<Waypoint> waypoints;
+          // 補間式を冪基底の係数に直し、処理位置を前進差分で一つずつ進める
+          HermiteEvaluator spline {path, clarity};
           //　明瞭度の分繰り返される（イテレータは1から始める）
           for (int i = 1; i <= clarity; i++) {
-              // 現在処理位置を求める
-              float x = segment * i;
-              // 処理位置を元に現在の姿勢を求める
-              current = CubicHermiteInterpolation(path, previous, x);
-              // 現在と前回の姿勢の差を（previous）に導入
-              previous = previous.getError(current);
-              // 現在角度と前回角度の差を比例拡大して逆数を取ります（この値は経路の曲率が高いほど小さくなります）
-              // 速度プロフィールの現在処理値値を計算（区分的補間の場合、二番目の補間の際　index　が50となっている）
+              float x = spline.x, y = spline.y; //　前回の位置
+              spline.next(); //　次の処理位置の位置、接線の角度、曲率を求める
+              float ds = hypot(spline.x - x, spline.y - y); //　経由地間の距離
+              // 曲率に経由地間の距離を掛けた角度の変化を比例拡大して逆数を取ります（この値は経路の曲率が高いほど小さくなります）
+              // 速度プロフィールの現在処理値値を計算（区分的補間の場合、二番目の補間の際　index　が N / 2 となっている）
               // 上記の値はどちらとも0から1の範囲で、掛け合わせることで現在処理位置での速度を導けます。
-              float speed = (1 / (autonomous_rotation_scaler * fabs(previous.w) + 1)) * (profile.get(i + index));
+              float turn = fabs(spline.curvature) * ds * RadToDeg;
+              float speed = (1 / (autonomous_rotation_scaler * turn + 1)) * ProfileSpeed(profile, ProfileSample(i + index, N), length + dist + ds);
               // 経由地に代入していきます
               Waypoint waypoint;
-              waypoint.dist = length + dist + previous.getVector().getMagnitude(); //　各経由地間の距離の合計
+              waypoint.dist = length + dist + ds; //　各経由地間の距離の合計
               waypoint.heading.x = 0; //　非ホロノミック系ロボットは横行できません
               waypoint.heading.y = reverse ? -speed : speed; //　以前計算した速度の符号を逆走ブールによって決める
-              // ベクトルの差で計算した角度は０が右にありますがロボットのジャイロスコープは０が上にあるため90度を引きます。
+              // 接線の角度は０が右にありますがロボットのジャイロスコープは０が上にあるため90度を引きます。
               // 逆走の場合ロボットは反対の角度に向く必要があるので180度を足します。最後に角度を０から360度に制限する関数に通します。
-              waypoint.heading.w = bound(current.w - 90 + (reverse ? 180 : 0));
+              waypoint.heading.w = bound(spline.heading - 90 + (reverse ? 180 : 0));
               waypoints.push_back(waypoint);// 経由地を軌道に加えます
-              // 次のループに備える
-              dist = dist + previous.getVector().getMagnitude(); // 今回の経由地間を合計距離に足す
-              previous = current; // 今回の姿勢を前回の姿勢に代入
+              dist = dist + ds; // 今回の経由地間を合計距離に足す
           }
           // 前と同じ理由で初期姿勢と最終姿勢に90度を引き、逆走の場合180度を足します。
           this -> initialPose = Pose {path.p0.x, path.p0.y, bound( path.t0.getAngle() - 90 + (reverse ? 180 : 0) )};
           this ->   finalPose = Pose {path.p1.x, path.p1.y, bound( path.t1.getAngle() - 90 + (reverse ? 180 : 0) )};
           this ->      length = dist;    // 経路の最終的長さは経由地間の距離の合計となります
           this ->       index = clarity; // 区分的補間を行う場合速度プロフィールを継げる為
-          return waypoints; // 軌道を呼び出し主に返す
+      }
+      /// @brief 車輪の運動学に基づき、曲がる時に外側の車輪が飽和しないよう経由地の速度を下げる。
+      /// 曲率 κ の経路を速度 v で走ると外側の車輪は v (1 + κ T / 2) で回るので、これが１以下になるよう速度を制限する。
+      /// @param trackWidth 左右の車輪の間隔（インチ）
+      void budgetWheels(float trackWidth) {
+          int n = waypoints.size();
+          if (type != spline || n < 2) return; // 直線補間の軌道は曲がらない
+          for (int i = 1; i < n; i++) {
+            Waypoint &waypoint = waypoints[i];
+            float ds = fmax(waypoint.dist - waypoints[i-1].dist, SMALL);
+            float curvature = fabs(wrap(waypoints[i-1].heading.w, waypoint.heading.w)) / RadToDeg / ds; // 曲率（1/インチ）
+            float limit = 1 / (1 + curvature * trackWidth / 2);
+            if (fabs(waypoint.heading.y) > limit) waypoint.heading.y = copysignf(limit, waypoint.heading.y);
+          }
       }
       /// @brief ある距離の入力に対し実行すべき経由地が返される
       /// @param distanceTraveled ロボットが進んだ距離（単位はインチ）
       /// @return 経由地
       Waypoint get(float distanceTraveled) {
           int i = 0;
-          while (this->waypoints.at(i).dist < distanceTraveled) i++; // 軌道を探りちょうど次の経由地を特定
-          return waypoints.at(i); // 経由地を返す
+          while (i < waypoints.size() - 1 && this->waypoints[i].dist < distanceTraveled) i++; // 軌道を探りちょうど次の経由地を特定
+          return waypoints[i]; // 経由地を返す
       }
   };
 
-  /// @brief ホロノミック系ロボットの経路計画クラス
-  class HolonomicTrajectory {
+  /// @brief ホロノミック系ロボットの経路計画クラス。経由地は容量 N の固定長配列に保存され、実行中に動的確保を行わない
+  /// @tparam N 経由地の数（区分的補間の場合は半分ずつ使うので偶数）
+  template <int N = TRAJECTORY_CAPACITY>
+  class BasicHolonomicTrajectory {
+    static_assert(N % 2 == 0, "waypoint capacity must be even");
     public:
-      std::vector<Waypoint> waypoints; //　最終的の軌道を表す　std::vector 
+      FixedVector<Waypoint, N> waypoints; //　最終的の軌道を表す固定長配列
       Pose initialPose {0,0,0}; //　初期姿勢
       Pose finalPose {0,0,0};   //　最終姿勢
       PathType type;     //　補間方法
@@ -223,119 +346,202 @@
       int index = 0;     //　イテレータ
       int aIndex = 0;    //　ホロノミック姿勢イテレータ（区分的補間の際に使用）
       float length = 0;  //　補間式の長さ
+      MarkerList<> markers; //　経路上の目印（経路実行が通過した時に呼ぶ）
+      static const int capacity = N;       //　経由地の容量
+      static const bool holonomic = true;  //　ホロノミック系の軌道か
     public:
       /// @brief 直線補間軌道を生成するコンストラクター
       /// @param trajectory2D 目的移動を示すベクトル（単位はインチ）
-      /// @param orientation OPTIONAL:  ホロノミック姿勢の　std::vector （処理位置０と１の姿勢は必ず定義されている）
+      /// @param orientation OPTIONAL:  ホロノミック姿勢の初期化リスト （処理位置０と１の姿勢は必ず定義されている）
       /// @param profile 速度プロフィール
-      HolonomicTrajectory(Vector trajectory2D, StaticProfile profile, std::vector<HolonomicPose> orientation = {}) {
+      /// @param interpolation OPTIONAL: ホロノミック姿勢の間の補間方法
+      template <class P>
+      BasicHolonomicTrajectory(Vector trajectory2D, P profile, std::initializer_list<HolonomicPose> orientation = {}, HeadingInterpolation interpolation = linearHeading) {
+          HeadingProfile heading {orientation, interpolation}; // ホロノミック姿勢を経由地と同時に一度だけ走査する補間器
           float angle = trajectory2D.getAngle() / RadToDeg; // 移動ベクトルの角度（度数）を保存
           float distance = trajectory2D.getMagnitude();     // 移動ベクトルの長さ（インチ）を保存
-          // 100個の経由地を生成しそれぞれの距離と角度を求めます
-          for(int i = 1; i <= 100; i++) { //　100回繰り返される（イテレータは1から）
-            float x = 0.01 * i;  //　0から1の処理位置を演算
+          PlanProfile(profile, distance);                   // 速度プロフィールを距離に合わせる
+          // N個の経由地を生成しそれぞれの距離と角度を求めます
+          for(int i = 1; i <= N; i++) { //　N回繰り返される（イテレータは1から）
+            float x = (float) i / N;  //　0から1の処理位置を演算
             Waypoint waypoint;   //　経由地を作成
-            float speed = profile.get(i); // 処理位置を速度プロフィールに問い保存
+            float speed = ProfileSpeed(profile, ProfileSample(i, N), distance * x); // 処理位置を速度プロフィールに問い保存
             waypoint.dist = distance * x; // 以前保存した長さから処理位置の距離を図る
             // ロボットを最終的に動かす関数がコントローラの入力を予想している為、アナログスティックの出力の真似をします
             // アナログスティックの出力の模倣は、進行方向と同じ角度の単位ベクトルで、その方向に全速力で進むことを意味する
             // 速度にかけることで適切な速度規制を可能とします
             waypoint.heading.x = speed * cosf(angle); // 移動ベクトルの　x　値に速度を掛ける
             waypoint.heading.y = speed * sinf(angle); // 移動ベクトルの　y　値に速度を掛ける
-            // この処理位置で以前定義した「ホロノミック姿勢補間関数」を呼び出しあるべき角度を保存
-            waypoint.heading.w = InterpolateHolonomicPose(orientation, x);
+            // この処理位置のあるべき角度を補間器に問い保存
+            waypoint.heading.w = heading.get(x);
             waypoints.push_back( waypoint ); // 軌道に経由地を追加
           }
           this -> type = linear;                      // 補間方法代入
-          this -> orientation = !orientation.empty(); // ホロノミック姿勢ブールを代入
+          this -> orientation = orientation.size() > 0; // ホロノミック姿勢ブールを代入
           this -> length = distance;                  // 補間式の長さを代入
       }
       /// @brief スプライン補間式を生成するコンストラクター（点Aと点Bのみで表せる経路に使用）
       /// @param path エルミート補間式の定義
-      /// @param orientation OPTIONAL: ホロノミック姿勢の　std::vector （範囲は０から１〜処理位置０と１の姿勢は必ず定義）
+      /// @param orientation OPTIONAL: ホロノミック姿勢の初期化リスト （範囲は０から１〜処理位置０と１の姿勢は必ず定義）
       /// @param profile 速度プロフィール
-      HolonomicTrajectory(Path path, StaticProfile profile, std::vector<HolonomicPose> orientation = {}) {
+      /// @param interpolation OPTIONAL: ホロノミック姿勢の間の補間方法
+      template <class P>
+      BasicHolonomicTrajectory(const Path &path, P profile, std::initializer_list<HolonomicPose> orientation = {}, HeadingInterpolation interpolation = linearHeading) {
+          HeadingProfile heading {orientation, interpolation}; // ホロノミック姿勢の補間器
+          PlanProfile(profile, &path, 1, N);                   // 速度プロフィールを補間式の長さに合わせる
           //（generate）関数を呼び点Aから点Bの間の補間を行う
-          this -> waypoints = generate(path, orientation, 100, profile);
-          this -> orientation = !orientation.empty();    //　ホロノミック姿勢ブールを代入
+          generate(path, heading, N, profile);
+          this -> orientation = orientation.size() > 0;    //　ホロノミック姿勢ブールを代入
           this -> type = spline;                         //　補間方法代入
       }
       /// @brief 区分的スプライン補間式を生成するコンストラクター（点A、点B、点C、で表す経路に使用）。
       /// これ以上の制御性を必する経路は分割すべきだと考えられます。
       /// @param path 区分的エルミート補間式の定義
-      /// @param orientation OPTINAL: ホロノミック姿勢の　std::vector 
+      /// @param orientation OPTINAL: ホロノミック姿勢の初期化リスト 
       /// 点Aから点Bの範囲は０から１、点Bから点Cの範囲は１から２（処理位置０と２は必ず定義）
       /// @param profile 速度プロフィール
-      HolonomicTrajectory(PathPlus path, StaticProfile profile, std::vector<HolonomicPose> orientation = {}) {
-          //（generate）関数を呼び点Aから点Bの間の補間を行う（明瞭度を100の半分に設定）
-          this -> waypoints = generate( Path {path.p0, path.p1, path.t0, path.t1}, orientation, 50, profile );
+      /// @param interpolation OPTIONAL: ホロノミック姿勢の間の補間方法
+      template <class P>
+      BasicHolonomicTrajectory(const PathPlus &path, P profile, std::initializer_list<HolonomicPose> orientation = {}, HeadingInterpolation interpolation = linearHeading) {
+          HeadingProfile heading {orientation, interpolation}; // 二つの区間で共有するホロノミック姿勢の補間器
+          Path paths[2] = { Path {path.p0, path.p1, path.t0, path.t1}, Path {path.p1, path.p2, path.t1, path.t2} };
+          PlanProfile(profile, paths, 2, N / 2); // 速度プロフィールを二つの補間式の長さの合計に合わせる
+          //（generate）関数を呼び点Aから点Bの間の補間を行う（明瞭度を容量の半分に設定）
+          generate( paths[0], heading, N / 2, profile );
           Pose tempInitialPose = initialPose; //　この時点で初期姿勢は点A。この姿勢を保存します
           float tempLength = length;          //　この時点で経路の長さは点Aから点Bの補間式の長さ。この長さを保存します
-          //（generate）関数を呼び点Bから点Cの間の補間を行う（明瞭度を100の半分に設定）
-          std::vector<Waypoint> waypoints2 = generate( Path {path.p1, path.p2, path.t1, path.t2}, orientation, 50, profile );
+          //（generate）関数を呼び点Bから点Cの間の補間を同じ配列の後ろに追加する（明瞭度を容量の半分に設定）
+          generate( paths[1], heading, N / 2, profile );
           this -> initialPose = tempInitialPose; //　事前に保存した点Aの姿勢を真の初期姿勢に代入
           this -> length = tempLength + length;  //　点Aから点Bの長さを点Bから点Cの長さに足し真の長さに代入
-          //　点Aから点Bの軌道を点Bから点Cの軌道と合体
-          this -> waypoints.insert(waypoints.end(), waypoints2.begin(), waypoints2.end());
-          this -> orientation = !orientation.empty(); // 　ホロノミック姿勢ブールを代入
+          this -> orientation = orientation.size() > 0; // 　ホロノミック姿勢ブールを代入
           this -> type = spline;                      //　補間方法代入
       }
-      /// @brief 軌道を生成する関数
+      /// @brief 軌道を生成し経由地の配列の末尾に追加する関数
       /// @param path エルミート補間式の定義
-      /// @param orientation ホロノミック姿勢の　std::vector 
-      /// @param clarity 明瞭度を示す（一つの経路は100と定められている）
-      /// @param profile 速度プロフィール
-      std::vector<Waypoint> generate(Path path, std::vector<HolonomicPose> orientation, int clarity, StaticProfile profile) {
-          float segment = 1.0 / clarity; //　処理位置の一つ一つの区間の長さを導く
+      /// @param heading ホロノミック姿勢の補間器
+      /// @param clarity 明瞭度を示す（一つの経路は N と定められている）
+      /// @param profile 速度プロフィール（計画済み）
+      template <class P>
+      void generate(const Path &path, HeadingProfile &heading, int clarity, P &profile) {
           float dist = 0; //　経路の長さを初期化
-          // 現在姿勢と前回姿勢を宣言
-          Pose previous {path.p0.x, path.p0.y, path.t0.getAngle()}; //　点Aの姿勢に設定　
-          Pose current {0, 0, 0}; //　初期化
-          //　軌道となる経由地の配列を作成
-          std::vector<Waypoint> waypoints;
+          // 補間式を冪基底の係数に直し、処理位置を前進差分で一つずつ進める
+          HermiteEvaluator spline {path, clarity};
           //　明瞭度の分繰り返される（イテレータは1から始める）
           for (int i = 1; i <= clarity; i++) {
-              // 現在処理位置を求める
-              float x = segment * i;
-              // 処理位置を元に現在の姿勢を求める
-              current = CubicHermiteInterpolation(path, previous, x);
-              // 現在と前回の姿勢の差を（previous）に導入
-              previous = previous.getError(current);
-              // 現在角度と前回角度の差を比例拡大して逆数を取ります（この値は経路の曲率が高いほど小さくなります）
-              // 速度プロフィールの現在処理値値を計算（区分的補間の場合、二番目の補間の際　index　が50となっている）
+              float x = spline.x, y = spline.y; //　前回の位置
+              spline.next(); //　次の処理位置の位置、接線の角度、曲率を求める
+              float ds = hypot(spline.x - x, spline.y - y); //　経由地間の距離
+              // 曲率に経由地間の距離を掛けた角度の変化を比例拡大して逆数を取ります（この値は経路の曲率が高いほど小さくなります）
+              // 速度プロフィールの現在処理値値を計算（区分的補間の場合、二番目の補間の際　index　が N / 2 となっている）
               // 上記の値はどちらとも0から1の範囲で、掛け合わせることで現在処理位置での速度を導けます。
-              float speed = (1 / (autonomous_rotation_scaler * fabs(previous.w) + 1)) * (profile.get(i + index));
+              float turn = fabs(spline.curvature) * ds * RadToDeg;
+              float speed = (1 / (autonomous_rotation_scaler * turn + 1)) * ProfileSpeed(profile, ProfileSample(i + index, N), length + dist + ds);
               // 経由地に代入していきます
               Waypoint waypoint;
-              waypoint.dist = length + dist + previous.getVector().getMagnitude(); //　各経由地間の距離の合計
+              waypoint.dist = length + dist + ds; //　各経由地間の距離の合計
               // ロボットを最終的に動かす関数がコントローラの入力を予想している為、アナログスティックの出力の真似をします
               // アナログスティックの出力の模倣は、進行方向と同じ角度の単位ベクトルで、その方向に全速力で進むことを意味する
-              // 速度にかけることで適切な速度規制を可能とします
-              waypoint.heading.x = cosf(previous.getVector().getAngle() / RadToDeg) * speed; 
-              waypoint.heading.y = sinf(previous.getVector().getAngle() / RadToDeg) * speed;
-              // この処理位置で以前定義した「ホロノミック姿勢補間関数」を呼び出しあるべき角度を保存                
-              waypoint.heading.w = InterpolateHolonomicPose(orientation, aIndex + x);
+              // 速度にかけることで適切な速度規制を可能とします（向きは処理位置の接線）
+              waypoint.heading.x = cosf(spline.heading / RadToDeg) * speed;
+              waypoint.heading.y = sinf(spline.heading / RadToDeg) * speed;
+              // この処理位置のあるべき角度を補間器に問い保存（補間器は前回の区間から探索を続ける）
+              waypoint.heading.w = heading.get(aIndex + (float) i / clarity);
               waypoints.push_back(waypoint);// 経由地を軌道に加えます
-              // 次のループに備える
-              dist = dist + previous.getVector().getMagnitude(); // 今回の経由地間を合計距離に足す
-              previous = current; // 今回の姿勢を前回の姿勢に代入
+              dist = dist + ds; // 今回の経由地間を合計距離に足す
           }
           // 初期姿勢と最終姿勢を定義。ホロノミック姿勢が示されていたら従って代入
-          this -> initialPose = Pose {path.p0.x, path.p0.y, orientation.empty() ? 0 : orientation.front().angle};
-          this ->   finalPose = Pose {path.p1.x, path.p1.y, orientation.empty() ? 0 : orientation.back().angle };
+          this -> initialPose = Pose {path.p0.x, path.p0.y, heading.first()};
+          this ->   finalPose = Pose {path.p1.x, path.p1.y, heading.last() };
           this ->      length = dist;    // 経路の最終的長さは経由地間の距離の合計となります
           this ->      aIndex = 1;       // 区分的補間を行う場合ホロノミック姿勢をつける為
           this ->       index = clarity; // 区分的補間を行う場合速度プロフィールを継げる為
-          return waypoints;              // 軌道を呼び出し主に返す
+      }
+      /// @brief 回転の物理的な制限を守るよう経由地の速度を下げる。
+      /// 角速度は（角度の変化 / 距離）× 速度なので、角速度と角加速度の上限を速度の上限に変換し前後二回の走査で適用する。
+      /// 制限は必ず守るので、角度の変化が急な所では元の軌道の最低速度より遅くなることもある。
+      /// @param constraints 回転の制限（maxSpeed は必ず定義）
+      /// @return 元の軌道の最低速度を下回らずに制限を守れたか（false なら角度の変化が急すぎて、その区間はプロフィールより遅く走る）
+      bool limitHeading(HeadingConstraints constraints) {
+          int n = waypoints.size();
+          if (!orientation || n < 2 || constraints.maxSpeed <= 0) return true;
+          bool kept = true; // 元の軌道の最低速度を下回らなかったか
+          float floor = 1;  // 元の軌道の最低速度
+          for (int i = 0; i < n; i++) floor = fmin(floor, Vector {waypoints[i].heading.x, waypoints[i].heading.y}.getMagnitude());
+          float v[N];     // 各経由地の速度（インチ毎秒）
+          float rate[N];  // 各経由地の角度の変化率（度毎インチ）
+          float ds[N];    // 各経由地までの区間の長さ（インチ）
+          for (int i = 0; i < n; i++) {
+            Waypoint &waypoint = waypoints[i];
+            ds[i] = i > 0 ? fmax(waypoint.dist - waypoints[i-1].dist, SMALL) : fmax(waypoint.dist, SMALL);
+            rate[i] = i > 0 ? fabs(wrap(waypoints[i-1].heading.w, waypoint.heading.w)) / ds[i] : 0;
+            v[i] = Vector {waypoint.heading.x, waypoint.heading.y}.getMagnitude() * constraints.maxSpeed;
+            // 角速度の上限
+            if (constraints.maxOmega > 0 && rate[i] > SMALL) v[i] = fmin(v[i], constraints.maxOmega / rate[i]);
+          }
+          // 角加速度の上限（前向きと後ろ向きの走査で角速度の変化を制限）。
+          // 区間の所要時間は区間に入る時の速度で求める（ds[i] / v[i-1]）
+          if (constraints.maxAlpha > 0) {
+            for (int i = 1; i < n; i++) {
+              if (rate[i] < SMALL) continue;
+              float dt = ds[i] / fmax(v[i-1], SMALL);
+              v[i] = fmin(v[i], (rate[i-1] * v[i-1] + constraints.maxAlpha * dt) / rate[i]);
+            }
+            // 減速側は所要時間が求める速度 v[i] 自身で決まるので、rate[i] v[i]^2 - ω v[i] - α ds <= 0 を解く
+            for (int i = n - 2; i >= 0; i--) {
+              if (rate[i] < SMALL) continue;
+              float omega = rate[i+1] * v[i+1];
+              v[i] = fmin(v[i], (omega + sqrt(omega * omega + 4 * rate[i] * constraints.maxAlpha * ds[i+1])) / (2 * rate[i]));
+            }
+          }
+          // 方向を保ったまま速度を書き換える
+          for (int i = 0; i < n; i++) {
+            Waypoint &waypoint = waypoints[i];
+            float speed = Vector {waypoint.heading.x, waypoint.heading.y}.getMagnitude();
+            if (speed < SMALL) continue;
+            float limited = v[i] / constraints.maxSpeed;
+            if (limited >= speed) continue;
+            if (limited < floor) kept = false;
+            waypoint.heading.x *= limited / speed;
+            waypoint.heading.y *= limited / speed;
+          }
+          return kept;
+      }
+      /// @brief 車輪の運動学に基づき、平面的横断と回転の合計で車輪が飽和しないよう経由地の速度を下げる。
+      /// ロボット視点の進行角度 φ で速度 v の横断は各車輪に v max(|cos(φ-45)|, |cos(φ-135)|) を使い、
+      /// 回転は角速度 / turnRate を使うので、この和が１以下になるよう速度を制限する（飽和による減速と経路の歪みを防ぐ）。
+      /// @param maxSpeed 速度出力１の時のロボットの速度（インチ毎秒）
+      /// @param turnRate 回転出力１の時のロボットの角速度（度毎秒）
+      void budgetWheels(float maxSpeed, float turnRate) {
+          int n = waypoints.size();
+          if (!orientation || turnRate <= 0) return; // 角度を指定しない場合は横断だけで１を超えない
+          for (int i = 0; i < n; i++) {
+            Waypoint &waypoint = waypoints[i];
+            float speed = Vector {waypoint.heading.x, waypoint.heading.y}.getMagnitude();
+            if (speed < SMALL) continue;
+            // ロボット視点の進行角度と、横断が一番使う車輪の割合
+            float phi = Vector {waypoint.heading.x, waypoint.heading.y}.getAngle() - waypoint.heading.w;
+            float usage = fmax(fabs(cosf((phi - 45) / RadToDeg)), fabs(cosf((phi - 135) / RadToDeg)));
+            // 角度の変化率（度毎インチ）から、速度１の時に回転が使う割合を求める
+            float ds = i > 0 ? fmax(waypoint.dist - waypoints[i-1].dist, SMALL) : fmax(waypoint.dist, SMALL);
+            float rate = i > 0 ? fabs(wrap(waypoints[i-1].heading.w, waypoint.heading.w)) / ds : 0;
+            float limit = 1 / (usage + rate * maxSpeed / turnRate);
+            if (speed <= limit) continue;
+            waypoint.heading.x *= limit / speed;
+            waypoint.heading.y *= limit / speed;
+          }
       }
       /// @brief ある距離の入力に対し実行すべき経由地が返される
       /// @param distanceTraveled ロボットが進んだ距離（単位はインチ）
       /// @return 経由地 
       Waypoint get(float distanceTraveled) {
           int i = 0;
-          while (this -> waypoints.at(i).dist < distanceTraveled) i++; // 軌道を探りちょうど次の経由地を特定
-          return waypoints.at(i); // 経由地を返す
+          while (i < waypoints.size() - 1 && this -> waypoints[i].dist < distanceTraveled) i++; // 軌道を探りちょうど次の経由地を特定
+          return waypoints[i]; // 経由地を返す
       }
   };
 
+  typedef BasicDifferentialTrajectory<> DifferentialTrajectory; //　既定の容量（経由地100個）の非ホロノミック系軌道
+  typedef BasicHolonomicTrajectory<> HolonomicTrajectory;       //　既定の容量（経由地100個）のホロノミック系軌道
+
 #endif
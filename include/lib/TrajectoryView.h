@@ -0,0 +1,199 @@
+#ifndef TRAJECTORY_VIEW
+#define TRAJECTORY_VIEW
+
+  #include "lib/Include.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/Pose.h"
+  #include "lib/Trajectory.h"
+  #include "lib/PathProgress.h"
+
+  /// @brief ホロノミック系の軌道のホロノミック姿勢が示されているか
+  template <int N>
+  bool OrientationOf(const BasicHolonomicTrajectory<N> &trajectory) {
+    return trajectory.orientation;
+  }
+
+  /// @brief 非ホロノミック系の軌道は、スプライン補間の場合に角度を追従する
+  template <int N>
+  bool OrientationOf(const BasicDifferentialTrajectory<N> &trajectory) {
+    return trajectory.type == spline;
+  }
+
+  /// @brief 生成済みの軌道を複製せずに、鏡映、回転、平行移動、逆走した軌道として見せるクラス。
+  /// 変換は経路実行が経由地を問うたびにその経由地だけに施すので、一つの軌道で全ての変種を走れる（経由地の追加の記憶はゼロ）。
+  /// 位置の変換は p' = R(angle) F p + offset（F は flipped の時の x の符号反転）で、
+  /// 変換を重ねる時は新しい変換を今までの変換の後に施す。回転と鏡映の中心はフィールドの原点
+  /// @tparam T 元の軌道（BasicDifferentialTrajectory か BasicHolonomicTrajectory）
+  template <class T>
+  class TrajectoryView {
+    private:
+      const T &source;        //　元の軌道（このビューより長く生きること）
+      float angle = 0;        //　回転の角度（度数）
+      bool flipped = false;   //　x の符号を反転するか（回転の前に施す）
+      Vector offset {0, 0};   //　平行移動（インチ）
+      bool reversed = false;  //　終点から始点へ逆に走るか
+    public:
+      Pose initialPose {0,0,0}; //　変換された初期姿勢
+      Pose finalPose {0,0,0};   //　変換された最終姿勢
+      PathType type;            //　補間方法
+      bool orientation;         //　ホロノミック姿勢が示されているか（非ホロノミック系はスプライン補間か）
+      float length = 0;         //　補間式の長さ
+      MarkerList<> markers;     //　経路上の目印（作成時に元の軌道から引き継ぎ、このビューの進み方で数える）
+      static const int capacity = T::capacity;   //　経由地の容量
+      static const bool holonomic = T::holonomic; //　ホロノミック系の軌道か
+    private:
+      /// @brief 位置を変換
+      Vector point(float x, float y) const {
+          Vector rotation {angle};
+          if (flipped) x = -x;
+          return Vector {rotation.x * x - rotation.y * y + offset.x, rotation.y * x + rotation.x * y + offset.y};
+      }
+      /// @brief 方向のベクトルを変換（平行移動しない）
+      Vector direction(float x, float y) const {
+          Vector rotation {angle};
+          if (flipped) x = -x;
+          return Vector {rotation.x * x - rotation.y * y, rotation.y * x + rotation.x * y};
+      }
+      /// @brief ロボットの角度を変換。前方向は角度＋90度なので、x の反転は w → -w、回転は w → w + angle となる
+      float heading(float w) const {
+          return bound(flipped ? angle - w : w + angle);
+      }
+      /// @brief 姿勢を変換
+      Pose pose(const Pose &p) const {
+          Vector position = point(p.x, p.y);
+          return Pose {position.x, position.y, heading(p.w)};
+      }
+      /// @brief 変換が変わった時に初期姿勢と最終姿勢を求め直す
+      void refresh() {
+          Pose first = pose(source.initialPose), last = pose(source.finalPose);
+          initialPose = reversed ? last : first;
+          finalPose = reversed ? first : last;
+      }
+      /// @brief 元の軌道の経由地 i の距離（i が ー１ の場合は始点の０）
+      float sourceDist(int i) const {
+          return i < 0 ? 0 : source.waypoints[i].dist;
+      }
+    public:
+      /// @brief 変換のないビューを作成
+      /// @param source 元の軌道（このビューより長く生きること）
+      TrajectoryView(const T &source) : source(source) {
+          type = source.type;
+          orientation = OrientationOf(source);
+          length = source.length;
+          markers = source.markers;
+          refresh();
+      }
+      /// @brief x の符号を反転する（y 軸に対する鏡映・左右の入れ替え）
+      TrajectoryView &mirrorX() {
+          flipped = !flipped;
+          angle = -angle;
+          offset.x = -offset.x;
+          refresh();
+          return *this;
+      }
+      /// @brief y の符号を反転する（x 軸に対する鏡映・前後の入れ替え）
+      TrajectoryView &mirrorY() {
+          mirrorX();
+          return rotate(180);
+      }
+      /// @brief フィールドの原点を中心に回転する
+      /// @param degrees 角度（度数・反時計回りが正）
+      TrajectoryView &rotate(float degrees) {
+          Vector rotation {degrees};
+          offset = Vector {rotation.x * offset.x - rotation.y * offset.y, rotation.y * offset.x + rotation.x * offset.y};
+          angle = bound(angle + degrees);
+          refresh();
+          return *this;
+      }
+      /// @brief 平行移動する
+      /// @param dx x 方向の移動（インチ）
+      /// @param dy y 方向の移動（インチ）
+      TrajectoryView &translate(float dx, float dy) {
+          offset.x += dx;
+          offset.y += dy;
+          refresh();
+          return *this;
+      }
+      /// @brief 終点から始点へ同じ経路を逆に走る（ロボットの角度は同じで、進む向きだけが逆になる）
+      TrajectoryView &reverse() {
+          reversed = !reversed;
+          refresh();
+          return *this;
+      }
+      /// @brief 経由地の数
+      int size() const {
+          return source.waypoints.size();
+      }
+      /// @brief 変換された経由地 i（O(1)）
+      Waypoint waypoint(int i) const {
+          int n = source.waypoints.size();
+          // 逆走の場合、経由地 i は元の経由地 n - 2 - i の位置（最後は元の始点）
+          int k = reversed ? n - 2 - i : i;
+          Waypoint waypoint = source.waypoints[k < 0 ? 0 : k];
+          if (reversed) {
+            waypoint.dist = length - sourceDist(k);
+            if (k < 0 && (!holonomic || orientation)) waypoint.heading.w = source.initialPose.w; // 元の始点の角度
+            waypoint.heading.x = -waypoint.heading.x;
+            waypoint.heading.y = -waypoint.heading.y;
+          }
+          if (holonomic) { // 速度は場の座標のベクトル
+            Vector velocity = direction(waypoint.heading.x, waypoint.heading.y);
+            waypoint.heading.x = velocity.x;
+            waypoint.heading.y = velocity.y;
+            if (orientation) waypoint.heading.w = heading(waypoint.heading.w);
+          } else { // 速度はロボットの前方向の出力なので角度だけ変換
+            waypoint.heading.w = heading(waypoint.heading.w);
+          }
+          return waypoint;
+      }
+      /// @brief 経由地 i - 1 から経由地 i までの距離（インチ・i が０の場合は始点から）
+      float segment(int i) const {
+          if (!reversed) return SegmentLength(source, i);
+          int n = source.waypoints.size();
+          return fmax(sourceDist(n - 1 - i) - sourceDist(n - 2 - i), 0);
+      }
+      /// @brief ある距離の入力に対し実行すべき経由地が返される（元の軌道の get と同じ）
+      /// @param distanceTraveled ロボットが進んだ距離（単位はインチ）
+      Waypoint get(float distanceTraveled) const {
+          int i = 0;
+          while (i < size() - 1 && waypoint(i).dist < distanceTraveled) i++;
+          return waypoint(i);
+      }
+  };
+
+  /// @brief ビューの経由地の数
+  template <class T>
+  int WaypointCount(const TrajectoryView<T> &view) {
+    return view.size();
+  }
+
+  /// @brief ビューの経由地 i - 1 から経由地 i までの距離
+  template <class T>
+  float SegmentLength(const TrajectoryView<T> &view, int i) {
+    return view.segment(i);
+  }
+
+  /// @brief ビューの経由地の進行方向（角度）
+  template <class T>
+  float TravelAngle(const TrajectoryView<T> &view, int i) {
+    Waypoint waypoint = view.waypoint(i);
+    if (T::holonomic) return Vector {waypoint.heading.x, waypoint.heading.y}.getAngle();
+    float angle = view.type == spline ? waypoint.heading.w : view.initialPose.w; // 直線補間は初期角度のまま
+    return bound(angle + 90 + (waypoint.heading.y < 0 ? 180 : 0));
+  }
+
+  /// @brief ビューの経由地 i の速度の出力の大きさ
+  template <class T>
+  float WaypointSpeed(const TrajectoryView<T> &view, int i) {
+    Waypoint waypoint = view.waypoint(i);
+    return hypot(waypoint.heading.x, waypoint.heading.y);
+  }
+
+  /// @brief ビューの現在の区間の経由地
+  template <class T>
+  Waypoint ReferenceWaypoint(TrajectoryView<T> &view, int i, float dist) {
+    return view.waypoint(i);
+  }
+
+#endif
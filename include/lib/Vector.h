@@ -1,7 +1,7 @@
 #ifndef VECTOR 
 #define VECTOR
 
-  #include "lib/Include.h"
+  #include "lib/Constants.h"
   #include "lib/Helpers.h"
   
   /// @brief ベクトルを定義するクラス
@@ -11,7 +11,7 @@
       float y = 0; //　ベクトルの　y　値
     public:
       /// @brief 既定のコンストラクター
-      Vector();
+      Vector() {}
       /// @brief x　と　y　値でベクトルを作成
       /// @param x ベクトルの　x　値
       /// @param y ベクトルの　y　値
@@ -61,12 +61,12 @@
       }
       /// @brief　このベクトルの長さ
       /// @return 長さ
-      float getMagnitude() {
+      float getMagnitude() const {
         return hypot(x, y); // 斜辺を求める関数
       }
       /// @brief このベクトルの角度
       /// @return　角度（度数）
-      float getAngle() {
+      float getAngle() const {
         return atan2f(y, x) * RadToDeg; //　逆正接関数・度数に変換
       }
   };
@@ -1,7 +1,8 @@
 #ifndef VELOCITY_PROFILE 
 #define VELOCITY_PROFILE
 
-  #include "lib/Include.h"
+  #include "lib/Constants.h"
+  #include "lib/Helpers.h"
 
   /// @brief 速度プロフィールを定義するクラス
   class StaticProfile {
@@ -41,5 +42,141 @@
           return ( m * m ) / ( c1 * c2 );
       }
   };
-  
+
+  /// @brief 躍度（加速度の変化率）を制限したS字の速度プロフィール。物理的な単位で定義し、
+  /// 経路の長さが決まった時に一度だけ７つの区間（躍度の増加・等加速度・躍度の減少・等速・その逆）を求める。
+  /// 時間による評価は区間の式を一度計算するだけ、距離による評価は区間内でニュートン法を数回行うだけで O(1)。
+  class SCurveProfile {
+    private:
+      float vmax;  //最大速度（インチ毎秒）
+      float amax;  //最大加速度（インチ毎秒毎秒）
+      float jmax;  //最大躍度（インチ毎秒毎秒毎秒）
+      float full;  //速度出力１の時のロボットの速度（インチ毎秒）
+      float v0;    //初期速度（インチ毎秒）
+      float v1;    //最終速度（インチ毎秒）
+      float T[8];  //各区間の始まりの時間（秒）
+      float S[8];  //各区間の始まりの距離（インチ）
+      float V[8];  //各区間の始まりの速度（インチ毎秒）
+      float A[8];  //各区間の始まりの加速度（インチ毎秒毎秒）
+      float J[7];  //各区間の躍度（インチ毎秒毎秒毎秒）
+    public:
+      float length = 0;   //計画した距離（インチ）
+      float duration = 0; //計画した所要時間（秒）
+    private:
+      /// @brief 速度 va から vb への加速（減速）の区間の長さを求める
+      /// @param ramp 躍度が一定の区間の時間（秒）
+      /// @param hold 加速度が一定の区間の時間（秒）
+      /// @return 加速（減速）の間に進む距離（インチ）
+      float ramp(float va, float vb, float &ramp, float &hold) const {
+          float dv = fabs(vb - va);
+          if (dv * jmax >= amax * amax) { // 最大加速度に達する
+            ramp = amax / jmax;
+            hold = dv / amax - ramp;
+          } else {                        // 最大加速度に達する前に躍度を反転
+            ramp = sqrt(dv / jmax);
+            hold = 0;
+          }
+          return (va + vb) / 2 * (2 * ramp + hold); // 対称な形なので平均速度は両端の平均
+      }
+      /// @brief 区間 k の始まりから dt 秒後の距離
+      float distanceIn(int k, float dt) const {
+          return S[k] + V[k] * dt + A[k] * dt * dt / 2 + J[k] * dt * dt * dt / 6;
+      }
+      /// @brief 区間 k の始まりから dt 秒後の速度
+      float velocityIn(int k, float dt) const {
+          return V[k] + A[k] * dt + J[k] * dt * dt / 2;
+      }
+    public:
+      /// @brief S字の速度プロフィールのコンストラクター
+      /// @param maximum_velocity 最大速度（インチ毎秒）
+      /// @param maximum_acceleration 最大加速度（インチ毎秒毎秒）
+      /// @param maximum_jerk 最大躍度（インチ毎秒毎秒毎秒）
+      /// @param full_speed 速度出力１の時のロボットの速度（インチ毎秒、車台の maxSpeed と同じ）
+      /// @param initial_velocity 初期速度（インチ毎秒）
+      /// @param final_velocity 最終速度（インチ毎秒・距離で追従する場合、０だと終点の直前で止まってしまうので少し残す）
+      /// @param distance 距離（インチ・軌道が生成時に計画し直す）
+      SCurveProfile(float maximum_velocity, float maximum_acceleration, float maximum_jerk, float full_speed = 60, float initial_velocity = 0, float final_velocity = 3, float distance = 0) {
+          this -> vmax = maximum_velocity;
+          this -> amax = fmax(maximum_acceleration, SMALL);
+          this -> jmax = fmax(maximum_jerk, SMALL);
+          this -> full = full_speed;
+          this -> v0 = fmin(initial_velocity, maximum_velocity);
+          this -> v1 = fmin(final_velocity, maximum_velocity);
+          plan(distance);
+      }
+      /// @brief 距離に合わせて７つの区間を求める（軌道の生成時に一度だけ呼ばれる）
+      /// @param distance 距離（インチ）
+      void plan(float distance) {
+          length = fmax(distance, 0);
+          float r1, h1, r2, h2;
+          // 最大速度まで加速して減速できるか。できなければ届く最高速度を二分探索で求める
+          float peak = vmax;
+          if (ramp(v0, peak, r1, h1) + ramp(peak, v1, r2, h2) > length) {
+            float low = fmax(v0, v1), high = vmax;
+            for (int i = 0; i < 30; i++) {
+              peak = (low + high) / 2;
+              if (ramp(v0, peak, r1, h1) + ramp(peak, v1, r2, h2) > length) high = peak; else low = peak;
+            }
+            peak = low;
+          }
+          float cruise = fmax(length - ramp(v0, peak, r1, h1) - ramp(peak, v1, r2, h2), 0) / fmax(peak, SMALL);
+          float times[7] = {r1, h1, r1, cruise, r2, h2, r2};
+          float jerks[7] = {jmax, 0, -jmax, 0, -jmax, 0, jmax};
+          T[0] = 0; S[0] = 0; V[0] = v0; A[0] = 0;
+          for (int k = 0; k < 7; k++) {
+            J[k] = jerks[k];
+            float d = times[k];
+            T[k + 1] = T[k] + d;
+            S[k + 1] = distanceIn(k, d);
+            V[k + 1] = velocityIn(k, d);
+            A[k + 1] = k == 2 || k == 6 ? 0 : A[k] + J[k] * d; // 躍度の区間の終わりは丸め誤差を残さない
+          }
+          duration = T[7];
+      }
+      /// @brief 時間 t の速度（インチ毎秒）
+      float velocityAtTime(float t) const {
+          if (t <= 0) return v0;
+          if (t >= duration) return v1;
+          int k = 6;
+          while (k > 0 && T[k] > t) k--;
+          return velocityIn(k, t - T[k]);
+      }
+      /// @brief 時間 t までに進んだ距離（インチ）
+      float distanceAtTime(float t) const {
+          if (t <= 0) return 0;
+          if (t >= duration) return S[7];
+          int k = 6;
+          while (k > 0 && T[k] > t) k--;
+          return distanceIn(k, t - T[k]);
+      }
+      /// @brief 距離 s に達する時間（秒）。区間内で安全策付きのニュートン法を使う
+      float timeAtDistance(float s) const {
+          if (s <= 0) return 0;
+          if (s >= S[7]) return duration;
+          int k = 6;
+          while (k > 0 && S[k] > s) k--;
+          float low = 0, high = T[k + 1] - T[k];
+          float dt = fitToRange((s - S[k]) / fmax(V[k], SMALL), low, high);
+          for (int i = 0; i < 8; i++) {
+            float error = distanceIn(k, dt) - s;
+            if (fabs(error) < 0.0001) break;
+            if (error > 0) high = dt; else low = dt;
+            float v = velocityIn(k, dt);
+            float next = dt - error / fmax(v, SMALL);
+            dt = next > low && next < high ? next : (low + high) / 2; // 範囲外なら二分法
+          }
+          return T[k] + dt;
+      }
+      /// @brief 距離 s の速度（インチ毎秒）
+      float velocityAtDistance(float s) const {
+          return velocityAtTime(timeAtDistance(s));
+      }
+      /// @brief 距離に相応しい速度出力を返します（StaticProfile と同じ使い方）
+      /// @param current 始点からの距離（インチ）
+      /// @return 速度出力 (0 から 1)
+      float get(float current) const {
+          return fitToRange(velocityAtDistance(current) / full, 0, 1);
+      }
+  };
+
   #endif
\ No newline at end of file
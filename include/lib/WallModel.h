@@ -0,0 +1,168 @@
+#ifndef WALL_MODEL
+#define WALL_MODEL
+
+  #include "lib/Constants.h"
+  #include "lib/Helpers.h"
+  #include "lib/Vector.h"
+  #include "lib/Pose.h"
+
+  /// @brief 壁の一辺（線分）
+  /// @param a 端点
+  /// @param b 端点
+  struct WallSegment {
+    Vector a;
+    Vector b;
+  };
+
+  /// @brief 距離センサの取り付け位置と向き（ロボット座標・x が右、y が前）
+  /// @param x 回転中心から右への距離（インチ）
+  /// @param y 回転中心から前への距離（インチ）
+  /// @param angle 向き（度数・０が前、反時計回りが正）
+  struct RangeMount {
+    float x;
+    float y;
+    float angle;
+  };
+
+  /// @brief 一つの距離センサの照合の結果（テレメトリ用）
+  /// @param measured 測定された距離（インチ・測定なしは ー１）
+  /// @param expected 現在の姿勢から壁の模型で予測した距離（インチ・壁がなければ ー１）
+  /// @param residual 測定と予測の差（インチ）
+  /// @param accepted 修正に使ったか
+  struct RangeCheck {
+    float measured;
+    float expected;
+    float residual;
+    bool accepted;
+  };
+
+  /// @brief 距離センサの測定を静的な壁の模型と照合し、オドメトリの位置のずれを求めるクラス。
+  /// 各センサの光線を壁に当て、予測した距離と測定した距離の差を壁の法線方向の位置の誤差とし、
+  /// 全てのセンサの誤差を最小二乗で一つの位置の修正にまとめる（壁の法線方向しか観測できないので、平行な壁だけでは片方の軸しか修正しない）。
+  /// 角度はジャイロを信頼し修正しない。SDK のヘッダを含まないので、模擬的な測定でホスト上でも試せる（tools/relocalization）
+  /// @tparam N 距離センサの最大数
+  /// @tparam W 壁の最大数
+  template <int N = 4, int W = 8>
+  class WallRelocalizer {
+    protected:
+      WallSegment walls[W]; //　壁の模型
+      RangeMount mounts[N]; //　距離センサの取り付け
+      int wallCount = 0;    //　壁の数
+      int count = 0;        //　距離センサの数
+    public:
+      RangeCheck checks[N];     //　前回の照合の結果
+      Vector correction {0, 0}; //　前回求めた位置の修正（インチ）
+      int accepted = 0;         //　前回修正に使ったセンサの数
+      float gate = 3;           //　予測との差がこれを超える測定は外れ値として捨てる（インチ）
+      float minIncidence = 0.5; //　光線と壁の法線のなす角の余弦の下限（斜めに当たる測定を捨てる）
+      float maxRange = 78;      //　信頼できる最大の距離（インチ）
+      float cornerMargin = 3;   //　壁の端からこの距離以内に当たる光線は隣の壁と紛らわしいので捨てる（インチ）
+    public:
+      /// @brief 壁の模型をフィールドの外周の四辺で作成
+      WallRelocalizer() {
+          const float FIELD_HALF = FIELD_SIZE / 2; //　原点から壁の内側までの距離
+          addWall(Vector {-FIELD_HALF, -FIELD_HALF}, Vector { FIELD_HALF, -FIELD_HALF});
+          addWall(Vector { FIELD_HALF, -FIELD_HALF}, Vector { FIELD_HALF,  FIELD_HALF});
+          addWall(Vector { FIELD_HALF,  FIELD_HALF}, Vector {-FIELD_HALF,  FIELD_HALF});
+          addWall(Vector {-FIELD_HALF,  FIELD_HALF}, Vector {-FIELD_HALF, -FIELD_HALF});
+      }
+      /// @brief 壁を加える（フィールドの要素など、動かない面）
+      /// @param a 端点
+      /// @param b 端点
+      /// @return 壁の番号（加えられない場合 ー１）
+      int addWall(Vector a, Vector b) {
+          if (wallCount >= W) return -1;
+          walls[wallCount] = WallSegment {a, b};
+          return wallCount++;
+      }
+      /// @brief 壁を全て消す
+      void clearWalls() {
+          wallCount = 0;
+      }
+      /// @brief 距離センサの取り付けを登録
+      /// @param x 回転中心から右への距離（インチ）
+      /// @param y 回転中心から前への距離（インチ）
+      /// @param angle 向き（度数・０が前、反時計回りが正）
+      /// @return センサの番号（登録できない場合 ー１）
+      int addMount(float x, float y, float angle) {
+          if (count >= N) return -1;
+          mounts[count] = RangeMount {x, y, angle};
+          checks[count] = RangeCheck {-1, -1, 0, false};
+          return count++;
+      }
+      /// @brief 距離センサの数
+      int size() const {
+          return count;
+      }
+      /// @brief 光線が最初に当たる壁までの距離
+      /// @param origin 光線の始点
+      /// @param direction 光線の向きの単位ベクトル
+      /// @param normal 当たった壁の法線の単位ベクトル（光線の始点の側を向く）の代入先
+      /// @param margin 当たった点から壁の端までの距離の代入先
+      /// @return 距離（インチ・当たらなければ ー１）
+      float cast(Vector origin, Vector direction, Vector &normal, float &margin) const {
+          float nearest = -1;
+          for (int i = 0; i < wallCount; i++) {
+            Vector edge {walls[i].b.x - walls[i].a.x, walls[i].b.y - walls[i].a.y};
+            float span = edge.getMagnitude();
+            float denominator = direction.x * edge.y - direction.y * edge.x;
+            if (span < SMALL || fabs(denominator) < SMALL) continue; // 平行
+            float dx = walls[i].a.x - origin.x, dy = walls[i].a.y - origin.y;
+            float t = (dx * edge.y - dy * edge.x) / denominator;         //　光線上の距離
+            float s = (dx * direction.y - dy * direction.x) / denominator; //　壁上の位置（0から1）
+            if (t <= 0 || s < 0 || s > 1 || (nearest >= 0 && t >= nearest)) continue;
+            nearest = t;
+            margin = fmin(s, 1 - s) * span;
+            normal = Vector {-edge.y / span, edge.x / span};
+            if (normal.x * dx + normal.y * dy > 0) normal.invert(); // 始点の側に向ける
+          }
+          return nearest;
+      }
+      /// @brief 距離センサの測定を壁の模型と照合し、位置の修正を求める（姿勢は変えない）
+      /// @param pose 測定した時のロボットの姿勢
+      /// @param readings 各センサの測定された距離（インチ・測定なしは負の値）
+      /// @param gate 外れ値とする予測との差（インチ）
+      /// @return 修正に使ったセンサがあるか
+      bool solve(const Pose &pose, const float *readings, float gate) {
+          // 法線方向の誤差の最小二乗（A δ = b）。観測できない方向が暴れないよう小さな正則化を加える
+          float a11 = 0.001, a12 = 0, a22 = 0.001, b1 = 0, b2 = 0;
+          Vector right {pose.w};      //　ロボットの右方向（角度０で x 方向）
+          Vector forward {pose.w + 90}; //　ロボットの前方向（角度０で y 方向）
+          accepted = 0;
+          for (int i = 0; i < count; i++) {
+            const RangeMount &mount = mounts[i];
+            RangeCheck &check = checks[i];
+            check = RangeCheck {readings[i], -1, 0, false};
+            Vector origin {
+              pose.x + right.x * mount.x + forward.x * mount.y,
+              pose.y + right.y * mount.x + forward.y * mount.y
+            };
+            Vector direction {pose.w + 90 + mount.angle};
+            Vector normal {0, 0};
+            float margin = 0;
+            check.expected = cast(origin, direction, normal, margin);
+            if (check.expected < 0 || readings[i] < 0) continue;
+            check.residual = readings[i] - check.expected;
+            float incidence = -(direction.x * normal.x + direction.y * normal.y); //　光線と法線のなす角の余弦
+            if (readings[i] > maxRange || incidence < minIncidence || margin < cornerMargin || fabs(check.residual) > gate) continue;
+            // 壁から離れている距離の誤差は、測定と予測の差を法線方向に直したもの
+            float error = check.residual * incidence;
+            a11 += normal.x * normal.x;
+            a12 += normal.x * normal.y;
+            a22 += normal.y * normal.y;
+            b1 += normal.x * error;
+            b2 += normal.y * error;
+            check.accepted = true;
+            accepted++;
+          }
+          float det = a11 * a22 - a12 * a12;
+          correction = accepted > 0 ? Vector {(a22 * b1 - a12 * b2) / det, (a11 * b2 - a12 * b1) / det} : Vector {0, 0};
+          return accepted > 0;
+      }
+      /// @brief 外れ値の既定の閾値で照合する
+      bool solve(const Pose &pose, const float *readings) {
+          return solve(pose, readings, gate);
+      }
+  };
+
+#endif
@@ -1,6 +1,8 @@
 #include "lib/Include.h"
 #include "lib/HolonomicDrive.h"
 #include "lib/Trajectory.h"
+#include "lib/Scheduler.h"
+#include "lib/DriverInput.h"
 
 using namespace vex;
 
@@ -18,7 +20,7 @@ HolonomicTrajectory traj {
   },
   // 速度プロフィールの定義
   StaticProfile{0.15, 0.05, 0.45, 0.35, 0.8},
-  std::vector<HolonomicPose> { // ホロノミック姿勢の配列を定義
+  {                            // ホロノミック姿勢のリストを定義
     HolonomicPose {0, 0},      // 点A（現在地）では0度を向いている
     HolonomicPose {0.3, 180},  // 点Aと点Bを結ぶ経路が30%終了した時、180度を向いている
     HolonomicPose {1, 300},    // 点B（途中地）では300度を向いている
@@ -30,38 +32,65 @@ HolonomicTrajectory traj {
 // ホロノミック車台を宣言
 HolonomicDrive drive;
 
+// 制御関数を一定の周期で実行する周期実行器
+PeriodicExecutor<> executor;
+
+// モータの温度と電流を管理する電力管理
+PowerManager power;
+
+// コントローラ入力処理（応答曲線と一秒あたりの最大変化）
+InputAxis<quadraticResponse> strafeAxis {4, 8};  // 左右の横断
+InputAxis<quadraticResponse> forwardAxis {4, 8}; // 前後の横断
+InputAxis<expoResponse, 60> turnAxis {6};         // 回転
+
 /// @brief プログラムが実行されると最初に呼ばれる関数
 /// 通常、センサーやモータの初期化を行う場所
 void pre_auton(void) {
   drive.init();  // 車台の初期化関数
+  drive.attach(power); // 車台のモータを電力管理に登録
   // 2秒処理を停止することで初期化の完了を待つ
   wait(2000, msec);
   // 車台の現在地を自己位置推定手法の原点として入力
   drive.setPose(traj.initialPose);  
 }
 
+/// @brief 自動操作の制御周期ごとに呼ばれる関数（経路実行は自己位置推定も行う）
+void autonomousTick(void) {
+  // 経路実行が完了したら周期実行を終える
+  if (drive.follow(traj) == 1) executor.stop();
+}
+
+/// @brief 手動操作の制御周期ごとに呼ばれる関数
+void usercontrolTick(void) {
+  /* 自己位置推定 */
+  drive.localize();
+  /* コントローラ入力処理 */
+  float x = strafeAxis.get( master.Axis4.value() );
+  float y = forwardAxis.get( master.Axis3.value() );
+  float omega = turnAxis.get( master.Axis1.value() );
+  drive.holdDrive( Vector(x, y), omega ); // 回転スティックが中央の時は角度を保つ
+}
+
+/// @brief モータの温度と電流を測定し出力の比率を更新する関数
+void powerTick(void) {
+  power.update();
+}
+
 /// @brief 自動操作の期間に呼ばれる関数
 void autonomous(void) {
-  // 経路実行が完了しない場合
-  while (drive.follow(traj) != 1) {
-    drive.localize(); // 自己位置推定手法
-    wait(10, msec);   // 処理が詰まらないようループごとに時間を空ける
-  }
+  executor.clear();
+  executor.add(autonomousTick, 10, 1); // 10msec ごとに経路実行
+  executor.add(powerTick, 50);         // 50msec ごとに電力管理
+  executor.run();                   // 経路実行が完了するまで戻らない
 }
 
 /// @brief 手動操作の期間に呼ばれる関数
 void usercontrol(void) {
-  while (true) {
-    /* 自己位置推定 */
-    drive.localize();
-    /* コントローラ入力処理 */
-    double x = quadradic( master.Axis4.value() );
-    double y = quadradic( master.Axis3.value() ); 
-    double omega = quadradic( master.Axis1.value());
-    drive.arcadeDrive( Vector(x, y), omega ); 
-    /* 処理が詰まらないようにループごとに 20msec 空ける */
-    wait(20, msec);
-  }
+  executor.clear();
+  drive.headingHold.hold(drive.pose.w); // 現在の角度から操作を始める
+  executor.add(usercontrolTick, 10, 1); // 10msec ごとにコントローラ入力処理
+  executor.add(powerTick, 50);          // 50msec ごとに電力管理
+  executor.run();
 }
 
 /// @brief プログラム実行時に最初に呼ばれる関数
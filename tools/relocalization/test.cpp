@@ -0,0 +1,109 @@
+// 壁との照合（include/lib/WallModel.h）を模擬的な測定で確かめるホスト側の試験。
+// 修正の符号と、各センサの測定を捨てる条件（外れ値、入射角、最大距離、壁の端）を一つずつ確かめる。
+//
+// ビルド:  g++ -std=gnu++11 -I include -o relocalization tools/relocalization/test.cpp
+// 使い方:  ./relocalization（失敗した項目を表示し、失敗があれば１を返す）
+
+#include <cstdio>
+#include "lib/WallModel.h"
+
+int failures = 0; //　失敗した項目の数
+
+/// @brief 条件を確かめ、結果を表示する
+void expect(bool condition, const char *name) {
+  printf("%s  %s\n", condition ? "ok  " : "FAIL", name);
+  if (!condition) failures++;
+}
+
+/// @brief 二つの値がほぼ等しいか
+bool near(float a, float b) {
+  return fabs(a - b) < 0.01;
+}
+
+int main() {
+  // 姿勢 (30, 40, 0) で前向き（+y）のセンサは上の壁（y = 72）まで 72 - 46.5 = 25.5 インチと予測する
+  Pose pose {30, 40, 0};
+  float readings[1];
+
+  // 予測より遠い測定は、ロボットが壁から離れている（下にいる）ことを示す
+  {
+    WallRelocalizer<> model;
+    model.addMount(0, 6.5, 0);
+    readings[0] = 27.5;
+    bool solved = model.solve(pose, readings);
+    expect(solved && model.accepted == 1, "forward reading accepted");
+    expect(near(model.checks[0].expected, 25.5), "forward expected distance");
+    expect(near(model.checks[0].residual, 2), "forward residual");
+    expect(near(model.correction.y, -2) && near(model.correction.x, 0), "farther reading moves the pose away from the wall");
+    readings[0] = 23.5;
+    model.solve(pose, readings);
+    expect(near(model.correction.y, 2), "nearer reading moves the pose toward the wall");
+  }
+
+  // 右向きのセンサ（右の壁 x = 72 まで 42 インチ）で x の修正の符号
+  {
+    WallRelocalizer<> model;
+    model.addMount(0, 0, -90);
+    readings[0] = 40;
+    model.solve(pose, readings);
+    expect(near(model.checks[0].expected, 42), "right expected distance");
+    expect(near(model.correction.x, 2) && near(model.correction.y, 0), "nearer right reading moves the pose right");
+  }
+
+  // 外れ値：予測との差が gate を超える測定は捨て、広い閾値を渡せば使う
+  {
+    WallRelocalizer<> model;
+    model.addMount(0, 6.5, 0);
+    readings[0] = 31.9;
+    expect(!model.solve(pose, readings) && !model.checks[0].accepted, "residual beyond gate rejected");
+    expect(near(model.correction.x, 0) && near(model.correction.y, 0), "rejected reading gives no correction");
+    expect(model.solve(pose, readings, 12) && near(model.correction.y, -6.4), "wide gate accepts the same reading");
+  }
+
+  // 入射角：壁に斜めに当たる光線（法線から70度）は予測通りの測定でも捨てる
+  {
+    WallRelocalizer<> model;
+    model.addMount(0, 6.5, 70);
+    readings[0] = -1;
+    model.solve(pose, readings);
+    readings[0] = model.checks[0].expected;
+    expect(readings[0] > 0 && readings[0] < model.maxRange, "oblique ray hits a wall within range");
+    expect(!model.solve(pose, readings), "oblique reading rejected by minIncidence");
+    model.minIncidence = 0.3;
+    expect(model.solve(pose, readings), "oblique reading accepted with a lower minIncidence");
+  }
+
+  // 最大距離：後ろ向きのセンサ（下の壁まで 105.5 インチ）は maxRange を超えるので捨てる
+  {
+    WallRelocalizer<> model;
+    model.addMount(0, -6.5, 180);
+    readings[0] = 105.5;
+    model.solve(pose, readings);
+    expect(near(model.checks[0].expected, 105.5), "rear expected distance");
+    expect(!model.checks[0].accepted, "reading beyond maxRange rejected");
+    model.maxRange = 120;
+    expect(model.solve(pose, readings), "reading accepted with a longer maxRange");
+  }
+
+  // 壁の端：角から cornerMargin 以内に当たる光線は捨てる
+  {
+    WallRelocalizer<> model;
+    model.addMount(0, 0, -90);
+    Pose corner {40, 70.5, 0};
+    readings[0] = 32;
+    expect(!model.solve(corner, readings) && near(model.checks[0].expected, 32), "reading near a corner rejected");
+    model.cornerMargin = 1;
+    expect(model.solve(corner, readings), "reading accepted with a smaller cornerMargin");
+  }
+
+  // 測定なし（負の値）は使わない
+  {
+    WallRelocalizer<> model;
+    model.addMount(0, 6.5, 0);
+    readings[0] = -1;
+    expect(!model.solve(pose, readings) && model.accepted == 0, "missing reading ignored");
+  }
+
+  printf("%d failure(s)\n", failures);
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+// 特性測定の CSV（include/lib/Characterization.h が保存したもの）から
+// kS、kV、kA、轍間距離、推奨 PID ゲインを最小二乗法で求めるホスト側のツール。
+//
+// ビルド:  g++ -std=c++11 -O2 -o fit tools/sysid/fit.cpp
+// 使い方:  ./fit sysid.csv [最大速度出力 (StaticProfile の m、省略時 0.8)] [経路の長さ (インチ、省略時 100)]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+const double RAD_TO_DEG = 180 / 3.14159265358979;  // 掛けて弧度法を度数法に
+const double PROFILE_SAMPLES = 100;  // StaticProfile の定義域（include/lib/Trajectory.h と同じ）
+
+/// @brief CSV の一行
+struct Sample {
+  int test;
+  int mode;  // 0: quasistatic, 1: dynamic
+  int axis;  // 0: 前進, 1: 回転
+  double time;
+  double voltage;
+  double velocity;
+  double acceleration;
+  double omega;
+  double alpha;
+  double wheel;
+};
+
+/// @brief V = kS * sgn(v) + kV * v + kA * a の当てはめ結果
+struct Fit {
+  double kS;
+  double kV;
+  double kA;
+  double r2;  // 決定係数
+  int count;  // 使った記録の数
+};
+
+/// @brief 3x3 の連立一次方程式をガウスの消去法で解く（部分ピボット選択）
+/// @return 解けたか（特異な場合 false）
+static bool solve3(double A[3][3], double b[3], double x[3]) {
+  for (int c = 0; c < 3; c++) {
+    int pivot = c;
+    for (int r = c + 1; r < 3; r++) if (std::fabs(A[r][c]) > std::fabs(A[pivot][c])) pivot = r;
+    if (std::fabs(A[pivot][c]) < 1e-12) return false;
+    for (int k = 0; k < 3; k++) std::swap(A[c][k], A[pivot][k]);
+    std::swap(b[c], b[pivot]);
+    for (int r = c + 1; r < 3; r++) {
+      double m = A[r][c] / A[c][c];
+      for (int k = c; k < 3; k++) A[r][k] -= m * A[c][k];
+      b[r] -= m * b[c];
+    }
+  }
+  for (int r = 2; r >= 0; r--) {
+    double s = b[r];
+    for (int k = r + 1; k < 3; k++) s -= A[r][k] * x[k];
+    x[r] = s / A[r][r];
+  }
+  return true;
+}
+
+/// @brief 同じ試験の中で加速度を前後 radius 個の移動平均で平滑化する（差分の雑音を減らす）
+static std::vector<double> smooth(const std::vector<Sample> &samples, bool angular, int radius) {
+  std::vector<double> out(samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    double sum = 0;
+    int n = 0;
+    for (int j = -radius; j <= radius; j++) {
+      long k = (long) i + j;
+      if (k < 0 || k >= (long) samples.size() || samples[k].test != samples[i].test) continue;
+      sum += angular ? samples[k].alpha : samples[k].acceleration;
+      n++;
+    }
+    out[i] = sum / n;
+  }
+  return out;
+}
+
+/// @brief 一つの動き（前進か回転）の記録に V = kS * sgn(v) + kV * v + kA * a を当てはめる
+/// @param threshold これより遅い記録は静止摩擦の区間として除く
+static Fit fitAxis(const std::vector<Sample> &all, int axis, double threshold) {
+  std::vector<Sample> samples;
+  for (size_t i = 0; i < all.size(); i++) if (all[i].axis == axis) samples.push_back(all[i]);
+  std::vector<double> accel = smooth(samples, axis == 1, 2);
+  double A[3][3] = {{0}}, b[3] = {0}, x[3] = {0};
+  std::vector<double> rows[4];
+  for (size_t i = 0; i < samples.size(); i++) {
+    double v = axis == 1 ? samples[i].omega : samples[i].velocity;
+    if (std::fabs(v) < threshold) continue;
+    double row[3] = { v > 0 ? 1.0 : -1.0, v, accel[i] };
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) A[r][c] += row[r] * row[c];
+      b[r] += row[r] * samples[i].voltage;
+    }
+    for (int k = 0; k < 3; k++) rows[k].push_back(row[k]);
+    rows[3].push_back(samples[i].voltage);
+  }
+  Fit fit = {0, 0, 0, 0, (int) rows[3].size()};
+  if (fit.count < 3 || !solve3(A, b, x)) return fit;
+  fit.kS = x[0];
+  fit.kV = x[1];
+  fit.kA = x[2];
+  double mean = 0;
+  for (int i = 0; i < fit.count; i++) mean += rows[3][i];
+  mean /= fit.count;
+  double residual = 0, total = 0;
+  for (int i = 0; i < fit.count; i++) {
+    double predicted = fit.kS * rows[0][i] + fit.kV * rows[1][i] + fit.kA * rows[2][i];
+    residual += (rows[3][i] - predicted) * (rows[3][i] - predicted);
+    total += (rows[3][i] - mean) * (rows[3][i] - mean);
+  }
+  fit.r2 = total > 0 ? 1 - residual / total : 0;
+  return fit;
+}
+
+/// @brief 回転の記録から轍間距離（実効値）を求める。車輪の速度 = 轍間距離 / 2 * 角速度（弧度）
+static double fitTrackWidth(const std::vector<Sample> &all) {
+  double num = 0, den = 0;
+  for (size_t i = 0; i < all.size(); i++) {
+    if (all[i].axis != 1 || std::fabs(all[i].omega) < 10) continue;
+    double w = all[i].omega / RAD_TO_DEG;
+    // 反時計回り（正）の回転では右の車輪が速く、左と右の差の半分は負になる
+    num += -all[i].wheel * w;
+    den += w * w;
+  }
+  return den > 0 ? 2 * num / den : 0;
+}
+
+static bool readCsv(const char *filename, std::vector<Sample> &samples) {
+  FILE *file = std::fopen(filename, "r");
+  if (file == NULL) return false;
+  char line[256];
+  if (std::fgets(line, sizeof line, file) == NULL) { std::fclose(file); return false; }  // 見出し行
+  while (std::fgets(line, sizeof line, file)) {
+    Sample s;
+    if (std::sscanf(line, "%d,%d,%d,%lf,%lf,%lf,%lf,%lf,%lf,%lf", &s.test, &s.mode, &s.axis, &s.time,
+                    &s.voltage, &s.velocity, &s.acceleration, &s.omega, &s.alpha, &s.wheel) == 10)
+      samples.push_back(s);
+  }
+  std::fclose(file);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s sysid.csv [profile max velocity (0-1), default 0.8] [path length (in), default 100]\n", argv[0]);
+    return 1;
+  }
+  std::vector<Sample> samples;
+  if (!readCsv(argv[1], samples) || samples.empty()) {
+    std::fprintf(stderr, "could not read samples from %s\n", argv[1]);
+    return 1;
+  }
+  double m = argc > 2 ? std::atof(argv[2]) : 0.8;
+  double length = argc > 3 ? std::atof(argv[3]) : PROFILE_SAMPLES;
+  if (length <= 0) length = PROFILE_SAMPLES;
+  const double V = 12;  // 電池の公称電圧
+
+  Fit linear = fitAxis(samples, 0, 0.5);
+  Fit angular = fitAxis(samples, 1, 5);
+  double trackWidth = fitTrackWidth(samples);
+
+  std::printf("samples: %d\n\n", (int) samples.size());
+  std::printf("linear   kS = %.4f V  kV = %.5f V/(in/s)  kA = %.5f V/(in/s^2)  r2 = %.4f  (%d samples)\n",
+              linear.kS, linear.kV, linear.kA, linear.r2, linear.count);
+  std::printf("angular  kS = %.4f V  kV = %.6f V/(deg/s)  kA = %.6f V/(deg/s^2)  r2 = %.4f  (%d samples)\n",
+              angular.kS, angular.kV, angular.kA, angular.r2, angular.count);
+  std::printf("effective track width = %.2f in\n\n", trackWidth);
+  if (linear.kV <= 0 || angular.kV <= 0) {
+    std::fprintf(stderr, "fit failed: run both linear and angular tests with enough motion\n");
+    return 1;
+  }
+
+  // 全電圧時の最高速度と、一次遅れ系としての時定数
+  double maxSpeed = (V - linear.kS) / linear.kV;
+  double turnRate = (V - angular.kS) / angular.kV;
+  double tau = std::fmax(linear.kA / linear.kV, 0);
+  double tauW = std::fmax(angular.kA / angular.kV, 0);
+  // 閉ループの時定数は遅れの４倍（振動しない程度）、最低0.15秒
+  double closed = std::fmax(4 * tau, 0.15);
+  double closedW = std::fmax(4 * tauW, 0.15);
+  // P制御で偏差 e に出力 kP * e を掛けると速度は maxSpeed * kP * e、時定数は 1 / (maxSpeed * kP)
+  double kP = 1 / (maxSpeed * closed);
+  double kPW = 1 / (turnRate * closedW);
+  // PID クラスの時間はミリ秒なので D ゲインは秒の値の1000倍
+  double kD = kP * tau * 1000;
+  double kDW = kPW * tauW * 1000;
+  // StaticProfile のシグモイドの最大加速度（速度 2m/3）が性能の８割に収まる傾き（１インチ当たり）
+  double available = (V - linear.kS - linear.kV * maxSpeed * 2 * m / 3) / std::fmax(linear.kA, 1e-6);
+  double slope = 0.8 * available * 27 / (4 * m * m * maxSpeed * maxSpeed);
+  // StaticProfile は距離ではなく経由地の番号（0 から PROFILE_SAMPLES）で引かれるので、経路の長さで定義域に直す
+  double sampleSlope = slope * length / PROFILE_SAMPLES;
+  // SCurveProfile は距離で引くので経路の長さによらない。最高速度でも出せる加速度の８割と、時定数で加速度に達する躍度
+  double vmax = m * maxSpeed;
+  double amax = 0.8 * (V - linear.kS - linear.kV * vmax) / std::fmax(linear.kA, 1e-6);
+  double jmax = amax / std::fmax(tau, 0.1);
+
+  std::printf("time constants: linear %.3f s, angular %.3f s\n\n", tau, tauW);
+  std::printf("// recommended settings\n");
+  std::printf("drive.maxSpeed = %.1f;   // in/s at full output\n", maxSpeed);
+  std::printf("drive.turnRate = %.1f;   // deg/s at full rotation output\n", turnRate);
+  std::printf("float trackWidth = %.2f; // for budgetWheels()\n", trackWidth);
+  std::printf("PID omegaPID {%.4f, 0, %.4f, %.4f, -1, 1};\n", kPW, kDW, angular.kS / V);
+  std::printf("PID alongPID {%.4f, 0, %.4f, 0, -1, 1};  // also xPID / yPID\n", kP, kD);
+  std::printf("StaticProfile{0.15, 0.05, %.3f, %.3f, %.2f};  // only for paths about %.0f in long\n", sampleSlope, sampleSlope, m, length);
+  std::printf("SCurveProfile{%.1f, %.1f, %.1f, %.1f};  // any path length\n", vmax, amax, jmax, maxSpeed);
+  return 0;
+}
@@ -0,0 +1,383 @@
+// Path / PathPlus の点を固定したまま接線ベクトル（角度と長さ）を探し、
+// 進入禁止領域の下で走行時間が最短になるものを求めるホスト側のツール。
+// 走行時間は既定では軌道の generate と同じ速度の規則（曲がり具合による減速と速度プロフィール）で求める。
+// 複数のスレッドでランダムな初期値からネルダー・ミード法を繰り返し、最良の結果を貼り付けられる形で出力する。
+//
+// ビルド:  g++ -std=c++11 -O2 -pthread -I include -o optimize tools/tangent/optimize.cpp
+// 使い方:  ./optimize [オプション] x0 y0 x1 y1 [x2 y2]
+//   --speed v        速度出力１の時の速度（インチ毎秒、車台の maxSpeed、既定 60）
+//   --model m        走行時間の模型（generate: 軌道の generate と同じ規則（既定）、limits: 加速度と横加速度の制限）
+//   --static s1,s2,k1,k2,m  generate の模型の StaticProfile（既定 0.15,0.05,0.45,0.35,0.8）
+//   --scurve v,a,j   generate の模型に SCurveProfile を使う（インチ毎秒、毎秒毎秒、毎秒毎秒毎秒）
+//   --scaler k       autonomous_rotation_scaler（既定 0.4）
+//   --capacity n     軌道の経由地数（既定 100）
+//   --accel a        limits の模型の最大加速度（インチ毎秒毎秒、既定 80）
+//   --lateral a      limits の模型の最大横加速度（インチ毎秒毎秒、既定 60）
+//   --radius r       ロボットの半径（インチ、既定 9）
+//   --keepout x y r  円形の進入禁止領域（何度でも指定可）
+//   --start deg      始点の進行方向を固定（度、x 軸から反時計回り）
+//   --end deg        終点の進行方向を固定
+//   --tangents x,y,… 現在の接線（カンマ区切りで点の数だけ）。比較と初期値に使う
+//   --threads n      スレッド数（既定はコア数）
+//   --restarts n     スレッドごとの初期値の数（既定 32）
+//   --seed n         乱数の種（既定 1）
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+#include "lib/VelocityProfile.h"  // 軌道と同じ速度プロフィール（SDK に依存しない）
+
+const double PROFILE_SAMPLES = 100;  // StaticProfile の定義域（include/lib/Trajectory.h と同じ）
+const double FIELD = 72;        // フィールドの中心から壁までの距離（インチ）
+const double PENALTY = 100;     // 制約違反一インチ毎の罰（秒）
+const int SAMPLES = 200;        // 一つの補間式の標本数
+
+struct Vec {
+  double x;
+  double y;
+};
+
+/// @brief 走行時間の評価に使う制限
+struct Limits {
+  double speed;
+  double accel;
+  double lateral;
+  double radius;
+  std::vector<Vec> keepoutCenters;
+  std::vector<double> keepoutRadii;
+};
+
+/// @brief 軌道の generate と同じ速度の規則：経由地の速度出力は
+/// 1 / (autonomous_rotation_scaler * 経由地間の角度の変化 + 1) に速度プロフィールを掛けたもの
+struct GenerateModel {
+  double scaler = 0.4;    // autonomous_rotation_scaler（include/lib/Include.h と同じ）
+  int capacity = 100;     // 軌道の経由地数（TRAJECTORY_CAPACITY）
+  bool scurve = false;    // SCurveProfile を使うか（StaticProfile は経由地の番号、SCurveProfile は距離で引く）
+  StaticProfile staticProfile {0.15, 0.05, 0.45, 0.35, 0.8};
+  SCurveProfile scurveProfile {50, 80, 400, 60};
+};
+
+/// @brief 最適化する問題：固定した点と、固定された端の角度
+struct Problem {
+  std::vector<Vec> points;  // 点（２個か３個）
+  bool fixStart = false;
+  bool fixEnd = false;
+  double startAngle = 0;  // 弧度
+  double endAngle = 0;    // 弧度
+  Limits limits;
+  GenerateModel model;
+  bool scoreLimits = false;  // 加速度と横加速度の制限の模型で評価するか（既定は generate の模型）
+  /// @brief 変数（点ごとに角度と長さの対数）から接線ベクトルを求める（端の角度が固定されていればそれを使う）
+  std::vector<Vec> tangents(const std::vector<double> &v) const {
+    std::vector<Vec> t(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+      double angle = v[2 * i];
+      if (i == 0 && fixStart) angle = startAngle;
+      if (i == points.size() - 1 && fixEnd) angle = endAngle;
+      // 長さは隣の弦の0.5倍から4倍（短すぎると尖点、長すぎるとループになる）
+      double chord = 1e9;
+      if (i > 0) chord = std::fmin(chord, std::hypot(points[i].x - points[i - 1].x, points[i].y - points[i - 1].y));
+      if (i + 1 < points.size()) chord = std::fmin(chord, std::hypot(points[i + 1].x - points[i].x, points[i + 1].y - points[i].y));
+      double magnitude = std::fmin(std::fmax(std::exp(v[2 * i + 1]), 0.5 * chord), 4 * chord);
+      t[i] = Vec {magnitude * std::cos(angle), magnitude * std::sin(angle)};
+    }
+    return t;
+  }
+};
+
+/// @brief エルミート補間式の位置、一次微分、二次微分
+static void hermite(Vec p0, Vec p1, Vec t0, Vec t1, double u, Vec &p, Vec &d, Vec &dd) {
+  double u2 = u * u, u3 = u2 * u;
+  double h1 = 2 * u3 - 3 * u2 + 1, h2 = -2 * u3 + 3 * u2, h3 = u3 - 2 * u2 + u, h4 = u3 - u2;
+  double d1 = 6 * u2 - 6 * u, d2 = -6 * u2 + 6 * u, d3 = 3 * u2 - 4 * u + 1, d4 = 3 * u2 - 2 * u;
+  double e1 = 12 * u - 6, e2 = -12 * u + 6, e3 = 6 * u - 4, e4 = 6 * u - 2;
+  p = Vec {h1 * p0.x + h2 * p1.x + h3 * t0.x + h4 * t1.x, h1 * p0.y + h2 * p1.y + h3 * t0.y + h4 * t1.y};
+  d = Vec {d1 * p0.x + d2 * p1.x + d3 * t0.x + d4 * t1.x, d1 * p0.y + d2 * p1.y + d3 * t0.y + d4 * t1.y};
+  dd = Vec {e1 * p0.x + e2 * p1.x + e3 * t0.x + e4 * t1.x, e1 * p0.y + e2 * p1.y + e3 * t0.y + e4 * t1.y};
+}
+
+/// @brief 走行時間の評価結果
+struct Result {
+  double cost;     // 走行時間と罰の合計
+  double time;     // 加速度と横加速度の制限の下での走行時間（秒）
+  double generated;  // generate の速度の規則での走行時間（秒）
+  double length;   // 長さ（インチ）
+  double violation;  // 制約違反の合計（インチ）
+};
+
+/// @brief 軌道の generate と同じ明瞭度で経路を辿り、同じ規則で各経由地の速度出力を求める。
+/// 経由地の速度（速度出力に --speed を掛けたもの）でその経由地までの区間を走るとして走行時間を返す
+static double generatedTime(const Problem &problem, const std::vector<Vec> &t) {
+  const GenerateModel &model = problem.model;
+  int segments = (int) problem.points.size() - 1;
+  int clarity = model.capacity / segments;  // 区分的補間は容量を半分ずつ使う
+  std::vector<double> ds, turn;
+  double length = 0;
+  for (int s = 0; s < segments; s++) {
+    Vec last = problem.points[s];
+    for (int i = 1; i <= clarity; i++) {
+      Vec p, d, dd;
+      hermite(problem.points[s], problem.points[s + 1], t[s], t[s + 1], (double) i / clarity, p, d, dd);
+      double speed = std::sqrt(d.x * d.x + d.y * d.y);
+      double curvature = speed > 1e-9 ? std::fabs(d.x * dd.y - d.y * dd.x) / (speed * speed * speed) : 0;
+      double step = std::hypot(p.x - last.x, p.y - last.y);
+      ds.push_back(step);
+      turn.push_back(curvature * step * 180 / PI);  // 経由地間の角度の変化（度）
+      length += step;
+      last = p;
+    }
+  }
+  StaticProfile staticProfile = model.staticProfile;
+  SCurveProfile scurveProfile = model.scurveProfile;
+  scurveProfile.plan(length);
+  double time = 0, dist = 0;
+  for (size_t k = 0; k < ds.size(); k++) {
+    dist += ds[k];
+    double profile = model.scurve ? scurveProfile.get(dist) : staticProfile.get((k + 1) * PROFILE_SAMPLES / model.capacity);
+    double speed = profile / (model.scaler * turn[k] + 1) * problem.limits.speed;
+    time += ds[k] / std::fmax(speed, 1e-3);
+  }
+  return time;
+}
+
+/// @brief 接線から経路を標本化し、速度の上限（横加速度）、前向き（加速）と後ろ向き（減速）の走査で
+/// 速度を求めて走行時間を計算する。進入禁止領域と壁への侵入は罰として足す
+static Result evaluate(const Problem &problem, const std::vector<Vec> &t) {
+  const Limits &limits = problem.limits;
+  int segments = (int) problem.points.size() - 1;
+  int n = segments * SAMPLES + 1;
+  std::vector<double> ds(n, 0), vmax(n);
+  double violation = 0;
+  Vec last = problem.points[0];
+  for (int k = 0; k < n; k++) {
+    int s = std::min(k / SAMPLES, segments - 1);
+    double u = (double) (k - s * SAMPLES) / SAMPLES;
+    Vec p, d, dd;
+    hermite(problem.points[s], problem.points[s + 1], t[s], t[s + 1], u, p, d, dd);
+    double speed = std::sqrt(d.x * d.x + d.y * d.y);
+    double curvature = speed > 1e-9 ? std::fabs(d.x * dd.y - d.y * dd.x) / (speed * speed * speed) : 1e9;
+    vmax[k] = std::fmin(limits.speed, std::sqrt(limits.lateral / std::fmax(curvature, 1e-9)));
+    if (k > 0) ds[k] = std::hypot(p.x - last.x, p.y - last.y);
+    last = p;
+    // 壁と進入禁止領域への侵入
+    double wall = FIELD - limits.radius;
+    violation += std::fmax(std::fabs(p.x) - wall, 0) + std::fmax(std::fabs(p.y) - wall, 0);
+    for (size_t i = 0; i < limits.keepoutCenters.size(); i++) {
+      double gap = std::hypot(p.x - limits.keepoutCenters[i].x, p.y - limits.keepoutCenters[i].y);
+      violation += std::fmax(limits.keepoutRadii[i] + limits.radius - gap, 0);
+    }
+  }
+  // 始点と終点では止まっている
+  std::vector<double> v(vmax);
+  v[0] = 0;
+  v[n - 1] = 0;
+  for (int k = 1; k < n; k++) v[k] = std::fmin(v[k], std::sqrt(v[k - 1] * v[k - 1] + 2 * limits.accel * ds[k]));
+  for (int k = n - 2; k >= 0; k--) v[k] = std::fmin(v[k], std::sqrt(v[k + 1] * v[k + 1] + 2 * limits.accel * ds[k + 1]));
+  double time = 0, length = 0;
+  for (int k = 1; k < n; k++) {
+    time += 2 * ds[k] / std::fmax(v[k] + v[k - 1], 1e-6);
+    length += ds[k];
+  }
+  violation /= SAMPLES;
+  double generated = generatedTime(problem, t);
+  return Result {(problem.scoreLimits ? time : generated) + PENALTY * violation, time, generated, length, violation};
+}
+
+/// @brief ネルダー・ミード法で局所的に最小化する
+static std::vector<double> minimize(const Problem &problem, std::vector<double> start, double step, int iterations) {
+  int d = (int) start.size();
+  std::vector<std::vector<double> > simplex(d + 1, start);
+  std::vector<double> cost(d + 1);
+  for (int i = 0; i < d; i++) simplex[i + 1][i] += step;
+  for (int i = 0; i <= d; i++) cost[i] = evaluate(problem, problem.tangents(simplex[i])).cost;
+  for (int iteration = 0; iteration < iterations; iteration++) {
+    // 最良と最悪と二番目に悪い頂点
+    int best = 0, worst = 0;
+    for (int i = 1; i <= d; i++) {
+      if (cost[i] < cost[best]) best = i;
+      if (cost[i] > cost[worst]) worst = i;
+    }
+    int second = best;
+    for (int i = 0; i <= d; i++) if (i != worst && cost[i] > cost[second]) second = i;
+    if (cost[worst] - cost[best] < 1e-7) break;
+    std::vector<double> centroid(d, 0);
+    for (int i = 0; i <= d; i++) if (i != worst) for (int j = 0; j < d; j++) centroid[j] += simplex[i][j] / d;
+    auto along = [&](double k) {
+      std::vector<double> x(d);
+      for (int j = 0; j < d; j++) x[j] = centroid[j] + k * (simplex[worst][j] - centroid[j]);
+      return x;
+    };
+    std::vector<double> reflected = along(-1);
+    double fr = evaluate(problem, problem.tangents(reflected)).cost;
+    if (fr < cost[best]) {  // 拡大
+      std::vector<double> expanded = along(-2);
+      double fe = evaluate(problem, problem.tangents(expanded)).cost;
+      if (fe < fr) { simplex[worst] = expanded; cost[worst] = fe; }
+      else { simplex[worst] = reflected; cost[worst] = fr; }
+    } else if (fr < cost[second]) {  // 反射
+      simplex[worst] = reflected;
+      cost[worst] = fr;
+    } else {  // 収縮
+      std::vector<double> contracted = along(0.5);
+      double fc = evaluate(problem, problem.tangents(contracted)).cost;
+      if (fc < cost[worst]) {
+        simplex[worst] = contracted;
+        cost[worst] = fc;
+      } else {  // 最良の頂点に向かって縮小
+        for (int i = 0; i <= d; i++) {
+          if (i == best) continue;
+          for (int j = 0; j < d; j++) simplex[i][j] = simplex[best][j] + 0.5 * (simplex[i][j] - simplex[best][j]);
+          cost[i] = evaluate(problem, problem.tangents(simplex[i])).cost;
+        }
+      }
+    }
+  }
+  int best = 0;
+  for (int i = 1; i <= d; i++) if (cost[i] < cost[best]) best = i;
+  return simplex[best];
+}
+
+/// @brief 接線から探索の変数に直す
+static std::vector<double> variables(const std::vector<Vec> &t) {
+  std::vector<double> v;
+  for (size_t i = 0; i < t.size(); i++) {
+    v.push_back(std::atan2(t[i].y, t[i].x));
+    v.push_back(std::log(std::fmax(std::hypot(t[i].x, t[i].y), 1e-3)));
+  }
+  return v;
+}
+
+/// @brief Catmull-Rom に近い初期の接線（端は隣の点へ、途中は前後の点を結ぶ向き）
+static std::vector<Vec> initialTangents(const std::vector<Vec> &p) {
+  std::vector<Vec> t(p.size());
+  for (size_t i = 0; i < p.size(); i++) {
+    size_t a = i == 0 ? 0 : i - 1, b = i + 1 < p.size() ? i + 1 : i;
+    t[i] = Vec {(p[b].x - p[a].x) * (i == 0 || i + 1 == p.size() ? 1 : 0.5),
+                (p[b].y - p[a].y) * (i == 0 || i + 1 == p.size() ? 1 : 0.5)};
+  }
+  return t;
+}
+
+/// @brief 一つのスレッドの探索：初期値を乱数で揺らして局所最小化を繰り返す
+static void search(const Problem &problem, const std::vector<std::vector<double> > &seeds, int restarts,
+                   unsigned seed, std::vector<double> &best, double &bestCost) {
+  std::mt19937 random(seed);
+  std::normal_distribution<double> angle(0, 0.6), magnitude(0, 0.5);
+  bestCost = 1e18;
+  for (int r = 0; r < restarts; r++) {
+    std::vector<double> start = seeds[r % seeds.size()];
+    if (r >= (int) seeds.size()) {
+      for (size_t j = 0; j < start.size(); j += 2) {
+        start[j] += angle(random);
+        start[j + 1] += magnitude(random);
+      }
+    }
+    std::vector<double> x = minimize(problem, start, 0.3, 600);
+    x = minimize(problem, x, 0.05, 300);  // 小さな単体で仕上げる
+    double cost = evaluate(problem, problem.tangents(x)).cost;
+    if (cost < bestCost) { bestCost = cost; best = x; }
+  }
+}
+
+/// @brief "a,b,c" の形の一つの引数を数の列に直す
+static std::vector<double> list(char *cursor) {
+  std::vector<double> values;
+  char *end;
+  for (double value = std::strtod(cursor, &end); end != cursor; value = std::strtod(cursor, &end)) {
+    values.push_back(value);
+    cursor = *end == ',' ? end + 1 : end;
+  }
+  return values;
+}
+
+static void print(const Problem &problem, const std::vector<Vec> &t, const Result &result, const char *title) {
+  std::printf("// %s: %.3f s as generated, %.3f s under the accel/lateral limits, %.1f in", title, result.generated, result.time, result.length);
+  if (result.violation > 1e-6) std::printf(", VIOLATES keep-out/field by %.2f in", result.violation);
+  std::printf("\n%s {\n", problem.points.size() == 3 ? "PathPlus" : "Path");
+  for (size_t i = 0; i < problem.points.size(); i++)
+    std::printf("  Vector{%.1f,%.1f},\n", problem.points[i].x, problem.points[i].y);
+  for (size_t i = 0; i < t.size(); i++)
+    std::printf("  Vector{%.1f,%.1f}%s\n", t[i].x, t[i].y, i + 1 < t.size() ? "," : "");
+  std::printf("}\n");
+}
+
+int main(int argc, char **argv) {
+  Problem problem;
+  problem.limits.speed = 60;
+  problem.limits.accel = 80;
+  problem.limits.lateral = 60;
+  problem.limits.radius = 9;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  int restarts = 32;
+  unsigned seed = 1;
+  std::vector<double> numbers, given, scurve;
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    bool more = i + 1 < argc;
+    if (!std::strcmp(a, "--speed") && more) problem.limits.speed = std::atof(argv[++i]);
+    else if (!std::strcmp(a, "--accel") && more) problem.limits.accel = std::atof(argv[++i]);
+    else if (!std::strcmp(a, "--lateral") && more) problem.limits.lateral = std::atof(argv[++i]);
+    else if (!std::strcmp(a, "--radius") && more) problem.limits.radius = std::atof(argv[++i]);
+    else if (!std::strcmp(a, "--model") && more) problem.scoreLimits = !std::strcmp(argv[++i], "limits");
+    else if (!std::strcmp(a, "--scaler") && more) problem.model.scaler = std::atof(argv[++i]);
+    else if (!std::strcmp(a, "--capacity") && more) problem.model.capacity = std::max(2, std::atoi(argv[++i]));
+    else if (!std::strcmp(a, "--scurve") && more) scurve = list(argv[++i]);
+    else if (!std::strcmp(a, "--static") && more) {
+      std::vector<double> p = list(argv[++i]);
+      if (p.size() == 5) problem.model.staticProfile = StaticProfile(p[0], p[1], p[2], p[3], p[4]);
+    } else if (!std::strcmp(a, "--threads") && more) threads = std::max(1, std::atoi(argv[++i]));
+    else if (!std::strcmp(a, "--restarts") && more) restarts = std::max(1, std::atoi(argv[++i]));
+    else if (!std::strcmp(a, "--seed") && more) seed = (unsigned) std::atoi(argv[++i]);
+    else if (!std::strcmp(a, "--start") && more) { problem.fixStart = true; problem.startAngle = std::atof(argv[++i]) * PI / 180; }
+    else if (!std::strcmp(a, "--end") && more) { problem.fixEnd = true; problem.endAngle = std::atof(argv[++i]) * PI / 180; }
+    else if (!std::strcmp(a, "--keepout") && i + 3 < argc) {
+      problem.limits.keepoutCenters.push_back(Vec {std::atof(argv[i + 1]), std::atof(argv[i + 2])});
+      problem.limits.keepoutRadii.push_back(std::atof(argv[i + 3]));
+      i += 3;
+    } else if (!std::strcmp(a, "--tangents") && more) given = list(argv[++i]);  // "x,y,x,y,..."
+    else numbers.push_back(std::atof(a));
+  }
+  if (numbers.size() != 4 && numbers.size() != 6) {
+    std::fprintf(stderr, "usage: %s [--speed v] [--model generate|limits] [--static s1,s2,k1,k2,m] [--scurve v,a,j]\n"
+                         "       [--scaler k] [--capacity n] [--accel a] [--lateral a] [--radius r] [--keepout x y r]...\n"
+                         "       [--start deg] [--end deg] [--tangents tx,ty,...] [--threads n] [--restarts n]\n"
+                         "       [--seed n] x0 y0 x1 y1 [x2 y2]\n", argv[0]);
+    return 1;
+  }
+  if (scurve.size() == 3) {  // 速度出力１の速度は --speed
+    problem.model.scurve = true;
+    problem.model.scurveProfile = SCurveProfile(scurve[0], scurve[1], scurve[2], problem.limits.speed);
+  }
+  for (size_t i = 0; i < numbers.size(); i += 2) problem.points.push_back(Vec {numbers[i], numbers[i + 1]});
+
+  // 初期値：Catmull-Rom に近い接線と、与えられた接線
+  std::vector<std::vector<double> > seeds;
+  seeds.push_back(variables(initialTangents(problem.points)));
+  std::vector<Vec> current;
+  if (given.size() == 2 * problem.points.size()) {
+    for (size_t i = 0; i < given.size(); i += 2) current.push_back(Vec {given[i], given[i + 1]});
+    seeds.push_back(variables(current));
+  }
+
+  // スレッドごとに別の乱数の種で探索し、最良の結果を選ぶ
+  std::vector<std::vector<double> > bests(threads);
+  std::vector<double> costs(threads);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; i++)
+    workers.push_back(std::thread(search, std::cref(problem), std::cref(seeds), restarts, seed + 7919u * i,
+                                  std::ref(bests[i]), std::ref(costs[i])));
+  for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+  int best = 0;
+  for (int i = 1; i < threads; i++) if (costs[i] < costs[best]) best = i;
+
+  if (!current.empty()) print(problem, current, evaluate(problem, current), "current");
+  std::vector<Vec> t = problem.tangents(bests[best]);
+  print(problem, t, evaluate(problem, t), "optimized");
+  return 0;
+}